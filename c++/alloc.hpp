@@ -0,0 +1,52 @@
+#include <memory>
+#include <vector>
+
+#ifndef XIO_ALLOC
+#define XIO_ALLOC
+
+//-----------------------------------------------------------------------------
+
+namespace xio {
+
+//-----------------------------------------------------------------------------
+// allocator adaptor default-initializing elements that are constructed
+// without arguments, so that e.g. resize() leaves trivial elements
+// uninitialized instead of zeroing them before they are read from a file
+
+template<typename T, typename A = std::allocator<T>>
+class default_init : public A
+{
+	using traits = std::allocator_traits<A>;
+
+public:
+	template<typename U>
+	struct rebind
+	{
+		using other = default_init<U, typename traits::template rebind_alloc<U>>;
+	};
+
+	using A::A;
+
+	template<typename U>
+	void construct(U* p) { ::new(static_cast<void*>(p)) U; }
+
+	template<typename U, typename... B>
+	void construct(U* p, B&&... b)
+	{
+		traits::construct(static_cast<A&>(*this), p, std::forward<B>(b)...);
+	}
+};
+
+//-----------------------------------------------------------------------------
+// vector whose elements are left uninitialized on resize(), if trivial
+
+template<typename T>
+using raw_vector = std::vector<T, default_init<T>>;
+
+//-----------------------------------------------------------------------------
+
+}  // namespace xio
+
+//-----------------------------------------------------------------------------
+
+#endif // XIO_ALLOC
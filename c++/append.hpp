@@ -0,0 +1,114 @@
+#include <sys/stat.h>
+
+#ifndef XIO_APPEND
+#define XIO_APPEND
+
+//-----------------------------------------------------------------------------
+
+namespace xio {
+
+//-----------------------------------------------------------------------------
+
+namespace xio_details {
+
+//-----------------------------------------------------------------------------
+// read dimensions `d` of the array following file header `h`, converting
+// byte order as needed
+
+template<typename S, typename D>
+void r_dims_at(S& s, const header& h, D& d)
+{
+	if(!h.swapped()) xread(s, d);
+	else { swap_istream<S> t(s); xread(t, d); }
+}
+
+template<typename S, typename D>
+void w_dims_at(S& s, const header& h, const D& d)
+{
+	if(!h.swapped()) xwrite(s, d);
+	else { swap_ostream<S> t(s); xwrite(t, d); }
+}
+
+template<typename S, typename A>
+void w_elem_at(S& s, const header& h, const A& a)
+{
+	if(!h.swapped()) w_mem(s, base(a), size(a));
+	else { swap_ostream<S> t(s); w_mem(t, base(a), size(a)); }
+}
+
+//-----------------------------------------------------------------------------
+// append slices in the last dimension to the array stored in file `f`, that
+// is, elements of contiguous range `a`, whose dimensions but the last should
+// match the stored ones; the file should hold the array as its only object,
+// with a header of any uncompressed format without checksums. New elements
+// are written after the stored ones, and are made durable before the last
+// stored dimension is updated in place, so an interrupted call leaves the
+// stored array intact. Data following the array throw, unless `recover`,
+// in which case they are taken as left over by such a call and overwritten.
+// The element type should match that recorded in the header, where types
+// recorded as none, e.g. of records, are only checked against file size.
+
+template<typename F, typename A>
+void xappend(const F& f, const A& a, bool recover = false)
+{
+	static_assert(is_cont_triv<A>() && !is_fixed<A>(),
+		"Appending only supported for resizable contiguous ranges of trivial elements.");
+	XIO_STATS_CALL("save");
+
+	using T = elem<A>;
+	auto&& e = dims(a);
+	typename std::decay<decltype(e)>::type d = e;
+
+	header h;
+	fd_istream s;
+	xopen(s, f);
+	if(!r_head(s, h, f) || h.packed() || h.check || h.type != uint64_t(scalar_of<T>()))
+		throw e_format(f);
+	std::streamoff p = s.tellg();
+	r_dims_at(s, h, d);
+	std::streamoff q = s.tellg();
+	if(!s) throw e_format(f);
+
+	std::vector<size_t> m = dim_vec(d), n = dim_vec(e);
+	if(m.size() != n.size() || !m.size() || !std::equal(n.begin(), n.end() - 1, m.begin()))
+		throw e_format(f);
+
+	struct stat st;
+	uint64_t end = q + total(m) * sizeof(T), len = size(a) * sizeof(T);
+	if(::fstat(s.handle(), &st) || uint64_t(st.st_size) < end ||
+		(!recover && uint64_t(st.st_size) > end))
+		throw e_format(f);
+	s.close();
+
+	m.back() += n.back();
+	dim_set(d, m);
+
+	fd_ostream o;
+	o.open(f, std::ios_base::in | std::ios_base::out);
+	if(!o) throw e_open(f);
+	o.seekp(end);
+	w_elem_at(o, h, a);
+	o.sync();
+	if(!o || ::ftruncate(o.handle(), end + len)) throw e_write(f);
+
+	o.seekp(p);
+	w_dims_at(o, h, d);
+	o.sync(); o.close();
+	if(!o) throw e_write(f);
+}
+
+//-----------------------------------------------------------------------------
+
+}  // namespace xio_details
+
+//-----------------------------------------------------------------------------
+
+using xio_details::xappend;
+
+//-----------------------------------------------------------------------------
+
+}  // namespace xio
+
+//-----------------------------------------------------------------------------
+
+#endif // XIO_APPEND
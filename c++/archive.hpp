@@ -0,0 +1,257 @@
+#include <memory>
+#include <unordered_map>
+
+#ifndef XIO_ARCHIVE
+#define XIO_ARCHIVE
+
+//-----------------------------------------------------------------------------
+
+namespace xio {
+
+//-----------------------------------------------------------------------------
+
+namespace xio_details {
+
+//-----------------------------------------------------------------------------
+// archive entry exception
+
+struct e_archive : std::exception
+{
+	const char* what() const noexcept override
+	{
+		return "archive entry missing or duplicate\n";
+	}
+};
+
+//-----------------------------------------------------------------------------
+// archive: a file header followed by entries, each holding one object
+// serialized as in a file of the same format, and an index of all entries,
+// followed by the position of the index and a trailer signature, in the
+// byte order of the file. Entries are numbered in order of writing and may
+// be named; in uncompressed archives, the elements of each entry are aligned
+// as requested by the format, and each compressed entry starts a new block.
+
+inline const char* archive_magic() { return "\x89xioidx\n"; }
+
+constexpr uint64_t archive_tail() { return 16; }
+
+// `offset`, `size` in bytes of entry in the file; scalar type of elements
+struct archive_entry
+{
+	std::string name;
+	uint64_t offset, size, type;
+	XIO_FIELDS(name, offset, size, type)
+};
+
+//-----------------------------------------------------------------------------
+// writer of an archive to a file, adding entries one at a time without
+// keeping them in memory; the index is written on closing, so an archive
+// not closed cannot be read. Checksums are not supported.
+
+class archive_writer
+{
+	using S = std::ofstream;
+
+	std::string f;
+	format x;
+	std::vector<char> u;
+	S s;
+	std::vector<archive_entry> index;
+	std::unordered_map<std::string, size_t> names;
+	bool open;
+
+public:
+	template<typename F>
+	archive_writer(const F& f) : archive_writer(format(), f) {}
+
+	template<typename F>
+	archive_writer(const format& x, const F& f) :
+		f(c_str(f)), x(x), u(buffer_size()), open(true)
+	{
+		if(x.check != checksum::none) throw e_format(f);
+		xopen(s, f, u); w_head_dims(s, x, 0);
+	}
+
+	archive_writer(const archive_writer&) = delete;
+
+	~archive_writer() { if(open) try { close(); } catch(...) {} }
+
+	// entries added so far
+	size_t size() const { return index.size(); }
+
+	// add object `a` as an entry named `n`, unique unless empty; return its
+	// number
+	template<typename A>
+	size_t add(const std::string& n, const A& a)
+	{
+		XIO_STATS_CALL("save");
+		using std::placeholders::_1;
+		if(!n.empty() && !names.emplace(n, index.size()).second) throw e_archive();
+
+		uint64_t p = s.tellp(), d = x.pack == codec::none ? dims_size(a) : 0;
+		uint64_t o = round_up(p + d, x.align) - d;
+		std::vector<char> pad(x.pack == codec::none ? o - p : 0);
+		w_mem(s, pad.data(), pad.size());
+		o = s.tellp();
+		w_pack(s, x, std::bind(xwriter(), _1, std::cref(a)));
+		if(!s) throw e_write(f);
+		index.push_back(archive_entry{n, o, uint64_t(s.tellp()) - o, uint64_t(head_type<A>())});
+		return index.size() - 1;
+	}
+
+	// add unnamed entry
+	template<typename A>
+	size_t add(const A& a) { return add(std::string(), a); }
+
+	// write index and close file, throwing on failure
+	void close()
+	{
+		using std::placeholders::_1;
+		open = false;
+		uint64_t o = s.tellp();
+		w_swap(s, x, std::bind(xwriter(), _1, std::cref(index)));
+		if(swapped(x.order)) o = bswap(o);
+		write(s, o);
+		w_mem(s, archive_magic(), 8);
+		s.close();
+		if(!s) throw e_write(f);
+	}
+};
+
+//-----------------------------------------------------------------------------
+// reader of an archive from a file: the index is read on opening, then any
+// entry is loaded or memory-mapped by number or name, reading only that
+// entry. Not safe for concurrent use; separate readers may be used instead.
+
+class archive_reader
+{
+	using S = std::ifstream;
+
+	std::string f;
+	std::vector<char> u;
+	S s;
+	header h;
+	std::vector<archive_entry> index;
+	std::unordered_map<std::string, size_t> names;
+	std::shared_ptr<const mapping> m;
+
+	const archive_entry& entry(size_t i) const
+	{
+		if(i >= index.size()) throw e_archive();
+		return index[i];
+	}
+
+	size_t number(const std::string& n) const
+	{
+		size_t i = find(n);
+		if(i == index.size()) throw e_archive();
+		return i;
+	}
+
+public:
+	template<typename F>
+	archive_reader(const F& f) : f(c_str(f)), u(buffer_size())
+	{
+		using std::placeholders::_1;
+		xopen(s, f, u);
+		if(!r_head(s, h, f) || h.check) throw e_format(f);
+
+		uint64_t b = s.tellg(), o;
+		char g[8];
+		s.seekg(0, std::ios_base::end);
+		uint64_t e = s.tellg();
+		if(e < b + archive_tail()) throw e_format(f);
+		s.seekg(e - archive_tail());
+		read(s, o);
+		r_mem(s, g, 8);
+		if(h.swapped()) o = bswap(o);
+		if(!s || std::memcmp(g, archive_magic(), 8) || o < b || o > e - archive_tail())
+			throw e_format(f);
+
+		s.seekg(o);
+		if(!r_swap(s, h, std::bind(xreader(), _1, std::ref(index)))) throw e_format(f);
+		for(size_t i = 0; i < index.size(); ++i)
+		{
+			const archive_entry& x = index[i];
+			if(x.offset < b || x.offset > o || x.size > o - x.offset ||
+				x.type > uint64_t(scalar::f8))
+				throw e_format(f);
+			if(!x.name.empty()) names.emplace(x.name, i);
+		}
+	}
+
+	archive_reader(const archive_reader&) = delete;
+
+	// number of entries
+	size_t size() const { return index.size(); }
+
+	// name of entry `i`; empty if unnamed
+	const std::string& name(size_t i) const { return entry(i).name; }
+
+	// scalar type of the elements of entry `i`; none if not recorded
+	scalar type(size_t i) const { return scalar(entry(i).type); }
+
+	// number of entry named `n`, or size() if missing
+	size_t find(const std::string& n) const
+	{
+		auto i = names.find(n);
+		return i == names.end() ? index.size() : i->second;
+	}
+
+	// load entry `i`, whose scalar type, if recorded, should match that of `a`
+	template<typename A>
+	void load(size_t i, A& a)
+	{
+		XIO_STATS_CALL("load");
+		using std::placeholders::_1;
+		const archive_entry& e = entry(i);
+		scalar t = head_type<A>();
+		if(e.type && t != scalar::none && e.type != uint64_t(t)) throw e_format(f);
+		s.clear(); s.seekg(e.offset);
+		if(!r_pack(s, h, std::bind(xreader(), _1, std::ref(a)))) throw e_read(f);
+	}
+
+	template<typename A>
+	void load(const std::string& n, A& a) { load(number(n), a); }
+
+	// map entry `i`, a single array as for xmap(); the file is mapped once
+	// and shared by all views
+	template<typename T, typename D = uint64_t>
+	map_view<T, D> map(size_t i)
+	{
+		static_assert(is_triv<T>(), "Only trivially copyable elements can be mapped.");
+		const archive_entry& e = entry(i);
+		if(h.swapped() || h.packed() || (e.type && e.type != uint64_t(scalar_of<T>())))
+			throw e_format(f);
+
+		D d;
+		s.clear(); s.seekg(e.offset);
+		xread(s, d);
+		if(!s) throw e_format(f);
+
+		uint64_t o = s.tellg(), n = total(d), z = e.offset + e.size;
+		if(!m) m = std::make_shared<const mapping>(f);
+		if(o % alignof(T) || o > z || n > (z - o) / sizeof(T)) throw e_format(f);
+		return map_view<T, D>(m, reinterpret_cast<const T*>(m->data() + o), d);
+	}
+
+	template<typename T, typename D = uint64_t>
+	map_view<T, D> map(const std::string& n) { return map<T, D>(number(n)); }
+};
+
+//-----------------------------------------------------------------------------
+
+}  // namespace xio_details
+
+//-----------------------------------------------------------------------------
+
+using xio_details::archive_reader;
+using xio_details::archive_writer;
+
+//-----------------------------------------------------------------------------
+
+}  // namespace xio
+
+//-----------------------------------------------------------------------------
+
+#endif // XIO_ARCHIVE
@@ -0,0 +1,171 @@
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <thread>
+
+#ifndef XIO_ASYNC
+#define XIO_ASYNC
+
+//-----------------------------------------------------------------------------
+
+namespace xio {
+
+//-----------------------------------------------------------------------------
+// snapshot policy of asynchronous saving: copy objects on call, or borrow
+// them, in which case the caller must not modify them until saving completes
+
+enum class snapshot { copy, borrow };
+
+//-----------------------------------------------------------------------------
+
+namespace xio_details {
+
+//-----------------------------------------------------------------------------
+// double-buffered output stream: data are written to one buffer while the
+// other is being written to underlying stream `s` by a writer thread, which
+// lives as long as the stream and is handed full buffers one at a time
+
+template<typename S>
+class async_ostream
+{
+	S& s;
+	raw_vector<char> buf[2];
+	size_t cur, len;
+	mutable std::mutex mx;
+	std::condition_variable cv;
+	const char* pend;  // buffer handed to writer, if busy
+	size_t plen;
+	bool busy, quit, ok;
+	std::thread writer;
+
+	void run()
+	{
+		std::unique_lock<std::mutex> l(mx);
+		for(;;)
+		{
+			cv.wait(l, [this] { return busy || quit; });
+			if(!busy) return;
+			l.unlock();
+			bool r = bool(s.write(pend, plen));
+			l.lock();
+			ok = ok && r; busy = false;
+			cv.notify_all();
+		}
+	}
+
+	void wait(std::unique_lock<std::mutex>& l) { cv.wait(l, [this] { return !busy; }); }
+
+	void flush()
+	{
+		std::unique_lock<std::mutex> l(mx);
+		wait(l);
+		pend = buf[cur].data(); plen = len; busy = true;
+		cv.notify_all();
+		cur ^= 1; len = 0;
+	}
+
+public:
+	using char_type = char;
+
+	async_ostream(S& s, size_t n = 1 << 22) :
+		s(s), cur(0), len(0), pend(nullptr), plen(0), busy(false), quit(false), ok(true)
+	{
+		buf[0].resize(n); buf[1].resize(n);
+		writer = std::thread(&async_ostream::run, this);
+	}
+
+	~async_ostream()
+	{
+		{ std::lock_guard<std::mutex> l(mx); quit = true; }
+		cv.notify_all();
+		writer.join();
+	}
+
+	async_ostream& write(const char_type* p, std::streamsize k)
+	{
+		for(size_t m; k; p += m, k -= m)
+		{
+			m = std::min(size_t(k), buf[cur].size() - len);
+			std::memcpy(buf[cur].data() + len, p, m);
+			if((len += m) == buf[cur].size()) flush();
+		}
+		return *this;
+	}
+
+	// write remaining data and wait until written
+	void close()
+	{
+		if(len) flush();
+		std::unique_lock<std::mutex> l(mx);
+		wait(l);
+	}
+
+	explicit operator bool() const { std::lock_guard<std::mutex> l(mx); return ok; }
+	bool operator!() const { return !bool(*this); }
+};
+
+//-----------------------------------------------------------------------------
+// borrowed objects are passed by reference wrappers
+
+template<typename A>
+const A& unwrap(const A& a) { return a; }
+
+template<typename A>
+A& unwrap(std::reference_wrapper<A> a) { return a; }
+
+//-----------------------------------------------------------------------------
+// function object saving to file via double-buffered stream, throwing on
+// failure
+
+struct async_saver
+{
+	template<typename... A>
+	void operator()(const std::string& f, const A&... a) const
+	{
+		XIO_STATS_CALL("save");
+		posix o(buffer_size());
+		fd_ostream s(o);
+		xopen(s, f);
+		async_ostream<fd_ostream> w(s);
+		xwrite(w, unwrap(a)...);
+		w.close(); s.close();
+		if(!w || !s) throw e_write(f);
+	}
+};
+
+//-----------------------------------------------------------------------------
+// save objects to file asynchronously on another thread, returning a future
+// that reports completion and rethrows any exception on get(); only taking
+// a snapshot (if not borrowed) blocks the caller
+
+template<typename F, typename A, typename... B>
+std::future<void>
+xsave_async(snapshot p, const F& f, const A& a, const B&... b)
+{
+	std::string n = c_str(f);
+	return p == snapshot::copy ?
+		std::async(std::launch::async, async_saver(), n, a, b...) :
+		std::async(std::launch::async, async_saver(), n, std::cref(a), std::cref(b)...);
+}
+
+template<typename F, typename A, typename... B>
+std::future<void> xsave_async(const F& f, const A& a, const B&... b)
+{
+	return xsave_async(snapshot::copy, f, a, b...);
+}
+
+//-----------------------------------------------------------------------------
+
+}  // namespace xio_details
+
+//-----------------------------------------------------------------------------
+
+using xio_details::xsave_async;
+
+//-----------------------------------------------------------------------------
+
+}  // namespace xio
+
+//-----------------------------------------------------------------------------
+
+#endif // XIO_ASYNC
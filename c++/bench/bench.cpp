@@ -0,0 +1,355 @@
+#include <xio>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <list>
+#include <map>
+#include <new>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// load/save throughput and allocations of xio per object type, payload size
+// and target, printed as one JSON object per line:
+//
+//    bench [max_size [dir [filter]]]
+//
+// payload sizes grow by 16x from 64 bytes up to max_size (default 16M,
+// suffixes K, M, G allowed). Targets are files in dir (default /tmp) in
+// native, big-endian or compressed format, hence typically read from page
+// cache, and byte buffers in memory. Only types whose name contains filter
+// are measured. Type "raw" is the baseline of fwrite()/fread() or memcpy()
+// of the same number of bytes.
+
+//-----------------------------------------------------------------------------
+// allocation counting; all replaceable forms of operator new and delete
+// are replaced and kept out of line, so the compiler sees them matched
+
+static std::atomic<size_t> allocs(0);
+
+#define XIO_BENCH_NOINLINE __attribute__((noinline))
+
+XIO_BENCH_NOINLINE void* operator new(size_t n)
+{
+	++allocs;
+	if(void* p = std::malloc(n ? n : 1)) return p;
+	throw std::bad_alloc();
+}
+
+XIO_BENCH_NOINLINE void* operator new[](size_t n) { return operator new(n); }
+
+XIO_BENCH_NOINLINE void operator delete(void* p) noexcept { std::free(p); }
+XIO_BENCH_NOINLINE void operator delete[](void* p) noexcept { std::free(p); }
+XIO_BENCH_NOINLINE void operator delete(void* p, size_t) noexcept { std::free(p); }
+XIO_BENCH_NOINLINE void operator delete[](void* p, size_t) noexcept { std::free(p); }
+
+//-----------------------------------------------------------------------------
+// n-dimensional array, as in README
+
+template<typename Data, typename Dims = std::vector<size_t>>
+struct array_nd : Data
+{
+	Dims dims;
+	using Data::Data;
+};
+
+template<typename A, typename D>
+D& dims(array_nd<A, D>& a) { return a.dims; }
+
+template<typename A, typename D>
+const D& dims(const array_nd<A, D>& a) { return a.dims; }
+
+template<typename A>
+bool same(const A& a, const A& b) { return a == b; }
+
+template<typename A, typename D>
+bool same(const array_nd<A, D>& a, const array_nd<A, D>& b)
+{
+	return a.dims == b.dims && static_cast<const A&>(a) == static_cast<const A&>(b);
+}
+
+//-----------------------------------------------------------------------------
+// options and output
+
+struct options
+{
+	size_t max = size_t(1) << 24;
+	std::string dir = "/tmp";
+	std::string filter;
+
+	std::string file() const { return dir + "/xio_bench.xio"; }
+};
+
+size_t parse_size(const char* s)
+{
+	char* e;
+	size_t n = std::strtoull(s, &e, 10);
+	switch(*e)
+	{
+		case 'G': case 'g': return n << 30;
+		case 'M': case 'm': return n << 20;
+		case 'K': case 'k': return n << 10;
+	}
+	return n;
+}
+
+// repetitions of a measurement, such that about 64M bytes are processed
+size_t reps(size_t bytes) { return std::max<size_t>(3, std::min<size_t>(1000, (64 << 20) / bytes)); }
+
+// best time and corresponding allocations over repetitions
+class measure
+{
+	using clock = std::chrono::steady_clock;
+	clock::time_point t0;
+	size_t a0;
+
+public:
+	double time = 1e30;
+	size_t count = 0;
+
+	void start() { a0 = allocs; t0 = clock::now(); }
+
+	void stop()
+	{
+		double t = std::chrono::duration<double>(clock::now() - t0).count();
+		size_t a = allocs - a0;
+		if(t < time) { time = t; count = a; }
+	}
+};
+
+void report(const char* type, const char* target, const char* op,
+	size_t elems, size_t bytes, size_t r, const measure& m)
+{
+	std::printf("{\"type\": \"%s\", \"target\": \"%s\", \"op\": \"%s\", "
+		"\"elems\": %zu, \"bytes\": %zu, \"reps\": %zu, \"seconds\": %.9f, "
+		"\"MBps\": %.1f, \"allocs\": %zu}\n",
+		type, target, op, elems, bytes, r, m.time, bytes / m.time / 1e6, m.count);
+	std::fflush(stdout);
+}
+
+void check(bool ok, const char* type, const char* target)
+{
+	if(ok) return;
+	std::fprintf(stderr, "%s: wrong result on %s\n", type, target);
+	std::exit(1);
+}
+
+//-----------------------------------------------------------------------------
+// object wrappers: plain object or ragged layout
+
+struct plain
+{
+	template<typename A>
+	A& operator()(A& a) const { return a; }
+};
+
+struct ragged
+{
+	template<typename A>
+	auto operator()(A& a) const -> decltype(xio::ragged(a)) { return xio::ragged(a); }
+};
+
+//-----------------------------------------------------------------------------
+// save and load object `a` of `n` elements to/from file in format `f` and
+// to/from byte buffer
+
+template<typename A, typename W>
+void run_file(const options& o, const char* type, const char* target,
+	xio::format f, const A& a, size_t n, W w)
+{
+	size_t bytes = xio::to_bytes(w(a)).size(), r = reps(bytes);
+	measure s, l;
+
+	for(size_t i = 0; i < r; ++i) { s.start(); xio::xsave(f, o.file(), w(a)); s.stop(); }
+	report(type, target, "save", n, bytes, r, s);
+
+	for(size_t i = 0; i < r; ++i)
+	{
+		A b;
+		l.start(); xio::xload(o.file(), w(b)); l.stop();
+		check(same(a, b), type, target);
+	}
+	report(type, target, "load", n, bytes, r, l);
+}
+
+template<typename A, typename W>
+void run_mem(const char* type, const A& a, size_t n, W w)
+{
+	std::vector<char> v;
+	size_t bytes = xio::to_bytes(w(a)).size(), r = reps(bytes);
+	measure s, l;
+
+	for(size_t i = 0; i < r; ++i)
+	{
+		std::vector<char> u;
+		s.start(); u = xio::to_bytes(w(a)); s.stop();
+		v.swap(u);
+	}
+	report(type, "memory", "save", n, bytes, r, s);
+
+	for(size_t i = 0; i < r; ++i)
+	{
+		A b;
+		l.start(); xio::from_bytes(v, w(b)); l.stop();
+		check(same(a, b), type, "memory");
+	}
+	report(type, "memory", "load", n, bytes, r, l);
+}
+
+template<typename A, typename W = plain>
+void run(const options& o, const char* type, const A& a, size_t n, W w = W())
+{
+	if(std::string(type).find(o.filter) == std::string::npos) return;
+	using xio::format;
+	using xio::endian;
+	run_file(o, type, "file", format(), a, n, w);
+	run_file(o, type, "file_big", format(0, endian::big), a, n, w);
+	run_file(o, type, "file_packed", format(0, endian::native, xio::codec::packed), a, n, w);
+	run_mem(type, a, n, w);
+}
+
+//-----------------------------------------------------------------------------
+// baseline: raw bytes by fwrite()/fread() and memcpy()
+
+void run_raw(const options& o, size_t bytes)
+{
+	if(std::string("raw").find(o.filter) == std::string::npos) return;
+	xio::raw_vector<char> a(bytes);
+	for(size_t i = 0; i < bytes; ++i) a[i] = char(i * 7);
+	size_t r = reps(bytes);
+	measure s, l, c, d;
+
+	for(size_t i = 0; i < r; ++i)
+	{
+		s.start();
+		FILE* f = std::fopen(o.file().c_str(), "wb");
+		std::fwrite(a.data(), 1, bytes, f);
+		std::fclose(f);
+		s.stop();
+	}
+	report("raw", "file", "save", bytes, bytes, r, s);
+
+	for(size_t i = 0; i < r; ++i)
+	{
+		l.start();
+		FILE* f = std::fopen(o.file().c_str(), "rb");
+		xio::raw_vector<char> b(bytes);
+		size_t k = std::fread(b.data(), 1, bytes, f);
+		std::fclose(f);
+		l.stop();
+		check(k == bytes && b == a, "raw", "file");
+	}
+	report("raw", "file", "load", bytes, bytes, r, l);
+
+	xio::raw_vector<char> v;
+	for(size_t i = 0; i < r; ++i)
+	{
+		c.start();
+		xio::raw_vector<char> b(a.begin(), a.end());
+		c.stop();
+		v.swap(b);
+	}
+	report("raw", "memory", "save", bytes, bytes, r, c);
+
+	for(size_t i = 0; i < r; ++i)
+	{
+		d.start();
+		xio::raw_vector<char> b(v.begin(), v.end());
+		d.stop();
+		check(b == a, "raw", "memory");
+	}
+	report("raw", "memory", "load", bytes, bytes, r, d);
+}
+
+//-----------------------------------------------------------------------------
+// all types for payload of about `bytes` bytes
+
+void run_all(const options& o, size_t bytes)
+{
+	run_raw(o, bytes);
+
+	size_t n = std::max<size_t>(1, bytes / 4);
+	{
+		std::vector<float> a(n);
+		for(size_t i = 0; i < n; ++i) a[i] = i * .5f;
+		run(o, "vector<float>", a, n);
+
+		std::deque<float> d(a.begin(), a.end());
+		run(o, "deque<float>", d, n);
+
+		std::list<float> l(a.begin(), a.end());
+		run(o, "list<float>", l, n);
+	}
+	{
+		std::set<int> a;
+		for(size_t i = 0; i < n; ++i) a.insert(a.end(), int(i * 3));
+		run(o, "set<int>", a, n);
+	}
+	{
+		size_t m = std::max<size_t>(1, bytes / 12);
+		std::map<int, double> a;
+		for(size_t i = 0; i < m; ++i) a.emplace_hint(a.end(), int(i * 3), i * .5);
+		run(o, "map<int,double>", a, m);
+
+		std::unordered_map<int, double> u(a.begin(), a.end());
+		run(o, "unordered_map<int,double>", u, m);
+	}
+	{
+		size_t m = std::max<size_t>(1, bytes / 12);
+		std::vector<std::pair<int, double>> a(m);
+		for(size_t i = 0; i < m; ++i) a[i] = std::make_pair(int(i * 3), i * .5);
+		run(o, "vector<pair<int,double>>", a, m);
+	}
+	{
+		size_t m = std::max<size_t>(1, bytes / 72);
+		std::vector<std::vector<int>> a(m, std::vector<int>(16));
+		for(size_t i = 0; i < m; ++i) a[i][i % 16] = int(i);
+		run(o, "vector<vector<int>>", a, m);
+		run(o, "ragged<vector<vector<int>>>", a, m, ragged());
+	}
+	{
+		size_t m = std::max<size_t>(1, bytes / 24);
+		std::vector<std::string> a(m, std::string(16, 'x'));
+		for(size_t i = 0; i < m; ++i) a[i][i % 16] = char('a' + i % 26);
+		run(o, "vector<string>", a, m);
+		run(o, "ragged<vector<string>>", a, m, ragged());
+	}
+	{
+		size_t k = 16, m = std::max<size_t>(1, n / k);
+		array_nd<xio::raw_vector<float>> a(k * m);
+		a.dims = {k, m};
+		for(size_t i = 0; i < k * m; ++i) a[i] = i * .25f;
+		run(o, "array_nd<float>", a, k * m);
+	}
+	{
+		std::vector<bool> a(bytes * 8);
+		for(size_t i = 0; i < a.size(); ++i) a[i] = i % 3 == 0;
+		run(o, "vector<bool>", a, a.size());
+	}
+}
+
+//-----------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+	options o;
+	if(argc > 1) o.max = parse_size(argv[1]);
+	if(argc > 2) o.dir = argv[2];
+	if(argc > 3) o.filter = argv[3];
+
+	try
+	{
+		for(size_t b = 64; b <= o.max; b *= 16) run_all(o, b);
+	}
+	catch(std::exception& e)
+	{
+		std::cerr << e.what();
+		return 1;
+	}
+	std::remove(o.file().c_str());
+}
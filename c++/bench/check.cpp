@@ -0,0 +1,31 @@
+#include <xio>
+#include <string>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// compile-only checks of overload resolution, not run: each call should
+// select the intended overload for arguments as commonly passed
+
+// options select their own overloads of file operations given a non-const
+// file name
+void check_options(std::string name)
+{
+	std::vector<float> a;
+	xio::xsave(xio::format(), name, a);
+	xio::xsave(xio::posix(), name, a);
+	xio::xsave(xio::par(), name, a);
+	xio::xload(xio::posix(), name, a);
+	xio::xload(xio::par(), name, a);
+	xio::xload(xio::convert(), name, a);
+}
+
+// deserialization from bytes given by a non-const pointer and size
+void check_bytes(std::vector<char>& v)
+{
+	std::vector<float> a;
+	char* p = v.data();
+	size_t n = v.size();
+	xio::from_bytes(p, n, a);
+	a = xio::from_bytes<std::vector<float>>(p, n);
+	xio::from_bytes(v, a);
+}
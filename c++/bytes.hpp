@@ -0,0 +1,153 @@
+#ifndef XIO_BYTES
+#define XIO_BYTES
+
+//-----------------------------------------------------------------------------
+
+namespace xio {
+
+//-----------------------------------------------------------------------------
+
+namespace xio_details {
+
+//-----------------------------------------------------------------------------
+// byte buffer exception
+
+struct e_bytes : std::exception
+{
+	const char* what() const noexcept override
+	{
+		return "cannot read from byte buffer: too short\n";
+	}
+};
+
+//-----------------------------------------------------------------------------
+// input stream reading from a contiguous byte buffer, not owned; reading
+// beyond its end fails like a file stream at end of file
+
+class span_reader
+{
+	const char* b;
+	const char* p;
+	const char* e;
+	size_t last;
+	bool ok;
+
+public:
+	using char_type = char;
+
+	span_reader(const char* p, size_t n) : b(p), p(p), e(p + n), last(0), ok(true) {}
+
+	span_reader& read(char_type* d, std::streamsize n)
+	{
+		last = std::min(size_t(n), size_t(e - p));
+		if(last) std::memcpy(d, p, last);
+		p += last;
+		if(last < size_t(n)) ok = false;
+		return *this;
+	}
+
+	std::streamsize gcount() const { return last; }
+
+	std::streamoff tellg() const { return p - b; }
+
+	span_reader& seekg(std::streamoff o) { p = b + std::min(size_t(o), size_t(e - b)); return *this; }
+
+	span_reader& seekg(std::streamoff o, std::ios_base::seekdir d)
+	{
+		return seekg(o + (d == std::ios_base::beg ? 0 : d == std::ios_base::cur ? p - b : e - b));
+	}
+
+	// bytes not read yet
+	size_t left() const { return e - p; }
+
+	explicit operator bool() const { return ok; }
+	bool operator!() const { return !ok; }
+	void clear() { ok = true; }
+};
+
+//-----------------------------------------------------------------------------
+// output stream appending to a vector of bytes V, referenced; reserve
+// capacity in advance to avoid reallocation
+
+template<typename V = std::vector<char>>
+class vector_writer
+{
+	V& v;
+
+public:
+	using char_type = char;
+
+	vector_writer(V& v) : v(v) {}
+
+	vector_writer& write(const char_type* p, std::streamsize n)
+	{
+		v.insert(v.end(), p, p + n); return *this;
+	}
+
+	std::streamoff tellp() const { return v.size(); }
+
+	explicit operator bool() const { return true; }
+	bool operator!() const { return false; }
+};
+
+//-----------------------------------------------------------------------------
+// serialize objects to a new vector of bytes of exact size, as computed by
+// a dry run; no file header is written
+
+template<typename A, typename... B>
+std::vector<char> to_bytes(const A& a, const B&... b)
+{
+	XIO_STATS_CALL("save");
+	counter c;
+	xwrite(c, a, b...);
+	std::vector<char> v;
+	v.reserve(c.n);
+	vector_writer<> s(v);
+	xwrite(s, a, b...);
+	return v;
+}
+
+//-----------------------------------------------------------------------------
+// deserialize objects from a contiguous range of bytes, given by a pointer
+// and size or a range like std::vector<char>, throwing if too short; type A
+// is required on the one-argument version
+
+template<typename A, typename... B>
+void from_bytes(const char* p, size_t n, A& a, B&... b)
+{
+	XIO_STATS_CALL("load");
+	span_reader s(p, n);
+	xread(s, a, b...);
+	if(!s) throw e_bytes();
+}
+
+template<typename R, typename A, typename... B, only_if<is_range<R>{}> = 0>
+void from_bytes(const R& r, A& a, B&... b)
+{
+	from_bytes(reinterpret_cast<const char*>(base(r)), size(r) * sizeof(elem<R>), a, b...);
+}
+
+template<typename A>
+A from_bytes(const char* p, size_t n) { A a; from_bytes(p, n, a); return a; }
+
+template<typename A, typename R, only_if<is_range<R>{}> = 0>
+A from_bytes(const R& r) { A a; from_bytes(r, a); return a; }
+
+//-----------------------------------------------------------------------------
+
+}  // namespace xio_details
+
+//-----------------------------------------------------------------------------
+
+using xio_details::span_reader;
+using xio_details::vector_writer;
+using xio_details::to_bytes;
+using xio_details::from_bytes;
+
+//-----------------------------------------------------------------------------
+
+}  // namespace xio
+
+//-----------------------------------------------------------------------------
+
+#endif // XIO_BYTES
@@ -0,0 +1,270 @@
+#include <cstdlib>
+#include <future>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <typeindex>
+#include <unordered_map>
+#include <sys/stat.h>
+
+#ifndef XIO_CACHE
+#define XIO_CACHE
+
+//-----------------------------------------------------------------------------
+
+namespace xio {
+
+//-----------------------------------------------------------------------------
+// counters of a cache: requests served by a cached object or by a load in
+// flight; requests loading a file; entries evicted to stay within budget;
+// entries and their estimated size in bytes currently cached
+
+struct cache_stats
+{
+	uint64_t hits = 0, misses = 0, evictions = 0, entries = 0, bytes = 0;
+};
+
+//-----------------------------------------------------------------------------
+
+namespace xio_details {
+
+//-----------------------------------------------------------------------------
+// cached object key: canonical file path, file size and modification time
+// in nanoseconds, so a modified file is loaded again; and type of object
+
+struct cache_key
+{
+	std::string path;
+	uint64_t size, time;
+	std::type_index type;
+
+	bool operator==(const cache_key& k) const
+	{
+		return path == k.path && size == k.size && time == k.time && type == k.type;
+	}
+};
+
+struct cache_hash
+{
+	size_t operator()(const cache_key& k) const
+	{
+		size_t h = std::hash<std::string>()(k.path);
+		for(size_t x : {size_t(k.size), size_t(k.time), k.type.hash_code()})
+			h ^= x + 0x9e3779b97f4a7c15 + (h << 6) + (h >> 2);
+		return h;
+	}
+};
+
+template<typename F>
+cache_key make_key(const F& f, std::type_index t)
+{
+	char* r = ::realpath(c_str(f), nullptr);
+	if(!r) throw e_open(f);
+	std::string p(r);
+	std::free(r);
+
+	struct stat st;
+	if(::stat(p.c_str(), &st)) throw e_open(f);
+#ifdef __APPLE__
+	const struct timespec& m = st.st_mtimespec;
+#else
+	const struct timespec& m = st.st_mtim;
+#endif
+	return cache_key{p, uint64_t(st.st_size), uint64_t(m.tv_sec) * 1000000000 + m.tv_nsec, t};
+}
+
+//-----------------------------------------------------------------------------
+// estimated memory size in bytes of object `a`: exact for contiguous ranges
+// of trivial elements, otherwise its serialized size by a dry run
+
+template<typename A, only_if<is_cont_triv<A>{}> = 0>
+uint64_t cache_size(const A& a) { return size(a) * sizeof(elem<A>); }
+
+template<typename A, only_if<!is_cont_triv<A>{}> = 0>
+uint64_t cache_size(const A& a) { counter c; xwrite(c, a); return c.n; }
+
+//-----------------------------------------------------------------------------
+// cache of immutable objects loaded from files, shared by all requests for
+// the same file and type until evicted; safe for concurrent use. Concurrent
+// requests for an object not cached trigger a single load, the others
+// waiting for it; if the load fails, all of them throw and nothing is
+// cached. Least recently used objects are evicted when the estimated total
+// size exceeds the budget, where eviction only drops the reference held by
+// the cache. Mapped views count by the size of their elements. Only the
+// latest version of each file is kept per type: requesting a modified file
+// drops the object of its previous version.
+
+class cache
+{
+	using value = std::shared_ptr<const void>;
+
+	struct slot
+	{
+		std::shared_future<value> v;
+		uint64_t id, bytes;
+		bool ready;
+		std::list<cache_key>::iterator at;
+	};
+
+	using file = std::pair<std::string, std::type_index>;
+
+	mutable std::mutex m;
+	std::unordered_map<cache_key, slot, cache_hash> slots;
+	std::map<file, cache_key> latest;  // key per path and type
+	std::list<cache_key> lru;          // most recently used first
+	uint64_t budget, next;
+	cache_stats st;
+
+	void drop(std::unordered_map<cache_key, slot, cache_hash>::iterator i)
+	{
+		if(i->second.ready) { st.bytes -= i->second.bytes; --st.entries; }
+		auto v = latest.find(file(i->first.path, i->first.type));
+		if(v != latest.end() && v->second == i->first) latest.erase(v);
+		lru.erase(i->second.at);
+		slots.erase(i);
+	}
+
+	// drop object of previous version of file of key `k`, if any
+	void replace(const cache_key& k)
+	{
+		auto v = latest.emplace(file(k.path, k.type), k).first;
+		if(v->second == k) return;
+		auto i = slots.find(v->second);
+		v->second = k;
+		if(i != slots.end()) drop(i);
+	}
+
+	// evict least recently used objects but the one with key `k`
+	void trim(const cache_key* k = nullptr)
+	{
+		for(auto i = lru.end(); st.bytes > budget && i != lru.begin();)
+		{
+			auto j = slots.find(*--i);
+			if(!j->second.ready || (k && *i == *k)) continue;
+			++i; drop(j); ++st.evictions;
+		}
+	}
+
+	// object with key `k`, made by make(bytes) if not cached
+	template<typename G>
+	value get(const cache_key& k, G make)
+	{
+		std::unique_lock<std::mutex> l(m);
+		auto i = slots.find(k);
+		if(i != slots.end())
+		{
+			++st.hits;
+			lru.splice(lru.begin(), lru, i->second.at);
+			std::shared_future<value> v = i->second.v;
+			l.unlock();
+			return v.get();
+		}
+
+		++st.misses;
+		replace(k);
+		std::promise<value> p;
+		uint64_t id = next++;
+		lru.push_front(k);
+		slots.emplace(k, slot{p.get_future().share(), id, 0, false, lru.begin()});
+		l.unlock();
+
+		uint64_t n = 0;
+		value v;
+		try { v = make(n); }
+		catch(...)
+		{
+			p.set_exception(std::current_exception());
+			l.lock();
+			i = slots.find(k);
+			if(i != slots.end() && i->second.id == id) drop(i);
+			throw;
+		}
+
+		p.set_value(v);
+		l.lock();
+		i = slots.find(k);
+		if(i != slots.end() && i->second.id == id)
+		{
+			i->second.bytes = n; i->second.ready = true;
+			st.bytes += n; ++st.entries;
+			trim(&k);
+		}
+		return v;
+	}
+
+public:
+	// budget in bytes; unlimited by default
+	explicit cache(uint64_t budget = uint64_t(-1)) : budget(budget), next(0) {}
+
+	cache(const cache&) = delete;
+
+	// object of type A loaded by xload() from file `f`
+	template<typename A, typename F>
+	std::shared_ptr<const A> load(const F& f)
+	{
+		value v = get(make_key(f, typeid(A)), [&f](uint64_t& n)
+		{
+			std::shared_ptr<A> a = std::make_shared<A>();
+			xload(f, *a);
+			n = cache_size(*a);
+			return value(a);
+		});
+		return std::static_pointer_cast<const A>(v);
+	}
+
+	// view of file `f` mapped by xmap<T, D>()
+	template<typename T, typename D = uint64_t, typename F>
+	map_view<T, D> map(const F& f)
+	{
+		value v = get(make_key(f, typeid(map_view<T, D>)), [&f](uint64_t& n)
+		{
+			auto a = std::make_shared<const map_view<T, D>>(xmap<T, D>(f));
+			n = a->size() * sizeof(T);
+			return value(a);
+		});
+		return *std::static_pointer_cast<const map_view<T, D>>(v);
+	}
+
+	// set budget in bytes, evicting as needed
+	void limit(uint64_t n)
+	{
+		std::lock_guard<std::mutex> l(m);
+		budget = n; trim();
+	}
+
+	// drop all objects loaded; loads in flight are not cached
+	void clear()
+	{
+		std::lock_guard<std::mutex> l(m);
+		while(!slots.empty()) drop(slots.begin());
+	}
+
+	cache_stats stats() const
+	{
+		std::lock_guard<std::mutex> l(m);
+		return st;
+	}
+};
+
+//-----------------------------------------------------------------------------
+// process-wide cache, opt-in; initially of unlimited budget
+
+inline cache& shared_cache() { static cache c; return c; }
+
+//-----------------------------------------------------------------------------
+
+}  // namespace xio_details
+
+//-----------------------------------------------------------------------------
+
+using xio_details::cache;
+using xio_details::shared_cache;
+
+//-----------------------------------------------------------------------------
+
+}  // namespace xio
+
+//-----------------------------------------------------------------------------
+
+#endif // XIO_CACHE
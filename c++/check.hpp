@@ -0,0 +1,399 @@
+#include <exception>
+
+#if defined(__GNUC__) && defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#define XIO_ARM_CRC
+#include <arm_acle.h>
+#endif
+
+#ifndef XIO_CHECK
+#define XIO_CHECK
+
+//-----------------------------------------------------------------------------
+
+namespace xio {
+
+//-----------------------------------------------------------------------------
+
+namespace xio_details {
+
+//-----------------------------------------------------------------------------
+// checksum exception
+
+struct e_check : std::exception
+{
+	const char* what() const noexcept override
+	{
+		return "checksum mismatch or invalid checksums\n";
+	}
+};
+
+//-----------------------------------------------------------------------------
+// CRC32C (Castagnoli), as computed by SSE4.2 and ARMv8 instructions; bits
+// are reflected, so the polynomial and all values below are bit-reversed
+
+constexpr uint32_t crc_poly() { return 0x82f63b78; }
+
+// lane size in bytes of vectorized versions, computing three CRCs at once
+constexpr size_t crc_lane() { return 1 << 12; }
+
+// product of polynomials `a`, `b` modulo the CRC polynomial
+inline uint32_t crc_mult(uint32_t a, uint32_t b)
+{
+	uint32_t p = 0;
+	for(uint32_t m = 1u << 31; m; m >>= 1)
+	{
+		if(a & m) p ^= b;
+		b = b & 1 ? (b >> 1) ^ crc_poly() : b >> 1;
+	}
+	return p;
+}
+
+// x^(8n) modulo the CRC polynomial, i.e. shift by `n` bytes
+inline uint32_t crc_shift(uint64_t n)
+{
+	uint32_t r = 1u << 31;
+	for(uint32_t b = 1u << 23; n; n >>= 1, b = crc_mult(b, b))
+		if(n & 1) r = crc_mult(r, b);
+	return r;
+}
+
+// multiplication by shift of crc_lane() bytes, by table lookup per byte;
+// the CRC of a concatenation A|B is then shift(crc(A)) ^ crc(B)
+struct crc_shifter
+{
+	uint32_t t[4][256];
+
+	crc_shifter()
+	{
+		uint32_t k = crc_shift(crc_lane());
+		for(size_t j = 0; j < 4; ++j)
+			for(uint32_t v = 0; v < 256; ++v) t[j][v] = crc_mult(k, v << (8 * j));
+	}
+
+	uint32_t operator()(uint32_t c) const
+	{
+		return t[0][c & 0xff] ^ t[1][c >> 8 & 0xff] ^ t[2][c >> 16 & 0xff] ^ t[3][c >> 24];
+	}
+};
+
+inline const crc_shifter& crc_lane_shift() { static const crc_shifter s; return s; }
+
+//-----------------------------------------------------------------------------
+// update CRC `c` by `n` bytes at `p`, where the CRC of no bytes is zero;
+// scalar version by table lookup per byte
+
+inline uint32_t crc32c_sc(uint32_t c, const char* p, size_t n)
+{
+	static const struct table
+	{
+		uint32_t t[256];
+		table()
+		{
+			for(uint32_t i = 0; i < 256; ++i)
+			{
+				uint32_t c = i;
+				for(int k = 0; k < 8; ++k) c = c & 1 ? (c >> 1) ^ crc_poly() : c >> 1;
+				t[i] = c;
+			}
+		}
+	} t;
+
+	c = ~c;
+	for(size_t i = 0; i < n; ++i) c = t.t[(c ^ uint8_t(p[i])) & 0xff] ^ (c >> 8);
+	return ~c;
+}
+
+//-----------------------------------------------------------------------------
+// versions by CRC instructions, 8 bytes at a time; on x86, three lanes are
+// processed at once to hide instruction latency, then combined
+
+#if defined(XIO_X86) && defined(__x86_64__)
+
+XIO_TARGET("sse4.2")
+inline uint32_t crc32c_sse42(uint32_t c, const char* p, size_t n)
+{
+	constexpr size_t L = crc_lane();
+	const crc_shifter& shift = crc_lane_shift();
+	uint64_t a = ~c, u;
+
+	for(; n >= 3 * L; n -= 3 * L, p += 3 * L)
+	{
+		uint64_t b = 0xffffffff, d = 0xffffffff, v, w;
+		for(size_t i = 0; i < L; i += 8)
+		{
+			std::memcpy(&u, p + i, 8);
+			std::memcpy(&v, p + L + i, 8);
+			std::memcpy(&w, p + 2 * L + i, 8);
+			a = _mm_crc32_u64(a, u);
+			b = _mm_crc32_u64(b, v);
+			d = _mm_crc32_u64(d, w);
+		}
+		uint32_t x = shift(~uint32_t(a)) ^ ~uint32_t(b);
+		a = ~(shift(x) ^ ~uint32_t(d));
+	}
+
+	for(; n >= 8; n -= 8, p += 8) { std::memcpy(&u, p, 8); a = _mm_crc32_u64(a, u); }
+	uint32_t r = uint32_t(a);
+	for(; n; --n) r = _mm_crc32_u8(r, uint8_t(*p++));
+	return ~r;
+}
+
+#endif
+
+#ifdef XIO_ARM_CRC
+
+inline uint32_t crc32c_arm(uint32_t c, const char* p, size_t n)
+{
+	uint64_t u;
+	c = ~c;
+	for(; n >= 8; n -= 8, p += 8) { std::memcpy(&u, p, 8); c = __crc32cd(c, u); }
+	for(; n; --n) c = __crc32cb(c, uint8_t(*p++));
+	return ~c;
+}
+
+#endif
+
+//-----------------------------------------------------------------------------
+// update CRC `c` by `n` bytes at `p`, using the fastest version available
+
+inline uint32_t crc32c(uint32_t c, const char* p, size_t n)
+{
+#if defined(XIO_X86) && defined(__x86_64__)
+	if(has_sse42()) return crc32c_sse42(c, p, n);
+#endif
+#ifdef XIO_ARM_CRC
+	return crc32c_arm(c, p, n);
+#endif
+	return crc32c_sc(c, p, n);
+}
+
+//-----------------------------------------------------------------------------
+// checksums of data following a file header, in blocks of size h.check:
+// the data are followed by a table of the CRC32C of each block, the size
+// of the data and a trailer signature, all in the byte order of the file.
+// Data remain contiguous, so files can still be mapped or read in part.
+
+inline const char* check_magic() { return "\x89xiocrc\n"; }
+
+constexpr uint64_t check_tail() { return 16; }
+
+inline uint32_t bswap32(uint32_t x) { return uint32_t(bswap(x) >> 32); }
+
+//-----------------------------------------------------------------------------
+// output stream computing checksums of data written to underlying stream
+// `s`, in chunks while still in cache; the table is written on closing
+
+template<typename S>
+class check_ostream
+{
+	S& s;
+	std::vector<uint32_t> sum;
+	uint64_t blk, pos;
+	uint32_t crc;
+	bool sw;
+
+	void update(const char* p, size_t n)
+	{
+		for(size_t m; n; p += m, n -= m)
+		{
+			m = std::min(n, size_t(blk - pos % blk));
+			crc = crc32c(crc, p, m);
+			if((pos += m) % blk == 0) { sum.push_back(crc); crc = 0; }
+		}
+	}
+
+public:
+	using char_type = char;
+
+	check_ostream(S& s, const format& x) :
+		s(s), blk(check_size()), pos(0), crc(0), sw(swapped(x.order)) {}
+
+	check_ostream& write(const char_type* p, std::streamsize n)
+	{
+		for(size_t m; n > 0; p += m, n -= m)
+		{
+			m = std::min(size_t(n), buffer_size());
+			update(p, m);
+			s.write(p, m);
+		}
+		return *this;
+	}
+
+	// position in data
+	std::streamoff tellp() const { return pos; }
+
+	void close()
+	{
+		if(pos % blk) sum.push_back(crc);
+		uint64_t n = sw ? bswap(pos) : pos;
+		if(sw) for(auto& c : sum) c = bswap32(c);
+		s.write(reinterpret_cast<const char*>(sum.data()), sum.size() * sizeof(uint32_t));
+		s.write(reinterpret_cast<const char*>(&n), sizeof(n));
+		s.write(check_magic(), 8);
+	}
+
+	explicit operator bool() const { return bool(s); }
+	bool operator!() const { return !s; }
+};
+
+//-----------------------------------------------------------------------------
+// input stream verifying checksums of data read from underlying stream `s`,
+// positioned after header `h`. The table is read on construction, and each
+// block is verified when read entirely from its beginning, throwing on
+// mismatch; blocks read in part after seeking, e.g. by partial loading, are
+// not verified. Reading beyond the data fails like a file stream at end of
+// file, so truncation is detected.
+
+template<typename S>
+class check_istream
+{
+	S& s;
+	std::streamoff base;
+	std::vector<uint32_t> sum;
+	uint64_t blk, len, pos;
+	size_t last;
+	uint32_t crc;
+	bool whole, ok;
+
+	// `whole` is true if `crc` covers the block of `pos` up to `pos`
+
+	void update(const char* p, size_t n)
+	{
+		for(size_t m; n; p += m, n -= m)
+		{
+			m = std::min(n, size_t(blk - pos % blk));
+			if(whole) crc = crc32c(crc, p, m);
+			pos += m;
+			if(pos % blk && pos < len) continue;
+			if(whole && crc != sum[(pos - 1) / blk]) throw e_check();
+			crc = 0; whole = true;
+		}
+	}
+
+	void table(bool sw)
+	{
+		char m[8];
+		uint64_t n;
+		s.seekg(0, std::ios_base::end);
+		std::streamoff e = s.tellg();
+		if(!s || e < base + std::streamoff(check_tail())) throw e_check();
+		s.seekg(e - check_tail());
+		s.read(reinterpret_cast<char*>(&n), sizeof(n));
+		s.read(m, sizeof(m));
+		len = sw ? bswap(n) : n;
+		uint64_t room = e - base - check_tail();
+		if(!s || std::memcmp(m, check_magic(), 8) || len > room ||
+			room - len != (len + blk - 1) / blk * sizeof(uint32_t))
+			throw e_check();
+
+		sum.resize((len + blk - 1) / blk);
+		s.seekg(base + len);
+		s.read(reinterpret_cast<char*>(sum.data()), sum.size() * sizeof(uint32_t));
+		if(!s) throw e_check();
+		if(sw) for(auto& c : sum) c = bswap32(c);
+		s.seekg(base);
+	}
+
+public:
+	using char_type = char;
+
+	check_istream(S& s, const header& h) :
+		s(s), base(s.tellg()), blk(h.check), len(0), pos(0), last(0),
+		crc(0), whole(true), ok(true)
+		{ table(h.swapped()); }
+
+	check_istream& read(char_type* p, std::streamsize n)
+	{
+		size_t k = std::min(uint64_t(n), pos < len ? len - pos : 0);
+		last = 0;
+		for(size_t m; ok && k; p += m, k -= m, last += m)
+		{
+			m = std::min(k, buffer_size());
+			s.read(p, m);
+			if(!s) { ok = false; break; }
+			update(p, m);
+		}
+		if(last < size_t(n)) ok = false;
+		return *this;
+	}
+
+	// verify the rest of the current block, if read from its beginning, e.g.
+	// when an object ends within the block, or when reading failed on data
+	// that may be corrupt; return false if reading had failed
+	bool finish()
+	{
+		bool r = ok;
+		if(!whole || !(pos % blk) || pos >= len) return r;
+		raw_vector<char> b(std::min(blk - pos % blk, len - pos));
+		clear(); read(b.data(), b.size());
+		return r && ok;
+	}
+
+	std::streamsize gcount() const { return last; }
+
+	// size of data
+	uint64_t size() const { return len; }
+
+	// positions in the underlying stream
+	std::streamoff tellg() const { return base + pos; }
+
+	check_istream& seekg(std::streamoff o)
+	{
+		uint64_t q = o - base;
+		if(q != pos) { pos = q; crc = 0; whole = pos % blk == 0; }
+		s.seekg(o);
+		return *this;
+	}
+
+	check_istream& seekg(std::streamoff o, std::ios_base::seekdir d)
+	{
+		return seekg(o + (d == std::ios_base::beg ? 0 : base +
+			std::streamoff(d == std::ios_base::cur ? pos : len)));
+	}
+
+	explicit operator bool() const { return ok; }
+	bool operator!() const { return !ok; }
+	void clear() { ok = true; s.clear(); }
+};
+
+//-----------------------------------------------------------------------------
+// verify checksums of all data of file `f`, without deserializing objects;
+// return false on mismatch or if the file is truncated. The file should have
+// a header with checksums.
+
+template<typename F>
+bool xverify(const F& f)
+{
+	XIO_STATS_CALL("load");
+	std::vector<char> u(buffer_size());
+	std::ifstream s;
+	header h;
+	xopen(s, f, u);
+	if(!r_head(s, h, f) || !h.check) throw e_format(f);
+
+	try
+	{
+		std::streamoff p = s.tellg();
+		check_istream<std::ifstream> c(s, h);
+		raw_vector<char> b(check_size());
+		while(c.read(b.data(), b.size())) {}
+		return uint64_t(c.tellg() - p) == c.size();
+	}
+	catch(e_check&) { return false; }
+}
+
+//-----------------------------------------------------------------------------
+
+}  // namespace xio_details
+
+//-----------------------------------------------------------------------------
+
+using xio_details::xverify;
+
+//-----------------------------------------------------------------------------
+
+}  // namespace xio
+
+//-----------------------------------------------------------------------------
+
+#endif // XIO_CHECK
@@ -0,0 +1,242 @@
+#ifndef XIO_COLUMNS
+#define XIO_COLUMNS
+
+//-----------------------------------------------------------------------------
+
+namespace xio {
+
+//-----------------------------------------------------------------------------
+
+namespace xio_details {
+
+//-----------------------------------------------------------------------------
+// invalid column directory exception
+
+struct e_columns : std::exception
+{
+	const char* what() const noexcept override
+	{
+		return "invalid column directory or selection\n";
+	}
+};
+
+//-----------------------------------------------------------------------------
+// field I of a record, as a projection like key_of/val_of of io.hpp
+
+template<size_t I>
+struct field_of
+{
+	template<typename T>
+	auto operator()(const T& a) const -> decltype(std::get<I>(fields_of(a)))
+		{ return std::get<I>(fields_of(a)); }
+};
+
+//-----------------------------------------------------------------------------
+// columnar ("struct of arrays") layout of a range `a` of records with fields
+// (see record.hpp), e.g. std::vector<point>: stored as the number of records,
+// a directory of the size in bytes of each column, and one column per field
+// holding that field of all records in a row, so trivial fields are copied
+// in bulk. On reading, only fields listed in `which` (all if empty) are read
+// and the remaining columns are skipped; `a` is resized, with the fields not
+// read left default. Only used when explicitly requested by wrapping `a`.
+
+template<typename A>
+struct columns_t
+{
+	A& a;
+	std::vector<size_t> which;
+	columns_t(A& a, std::vector<size_t> which) : a(a), which(std::move(which)) {}
+};
+
+// const, so that a temporary can be read into
+template<typename A>
+const columns_t<A> columns(A& a, std::vector<size_t> which = {})
+{
+	return columns_t<A>(a, std::move(which));
+}
+
+//-----------------------------------------------------------------------------
+// separate ranges `c`, e.g. std::vector of each field type, to read columns
+// listed in `which` into, from the columnar layout above; each column is
+// read as a range of elements, e.g. by a single memory copy if trivial
+
+template<typename... C>
+struct column_ranges_t
+{
+	std::vector<size_t> which;
+	std::tuple<C&...> c;
+	column_ranges_t(std::vector<size_t> which, C&... c) : which(std::move(which)), c(c...) {}
+};
+
+template<typename... C>
+const column_ranges_t<C...> column_ranges(std::vector<size_t> which, C&... c)
+{
+	return column_ranges_t<C...>(std::move(which), c...);
+}
+
+//-----------------------------------------------------------------------------
+// size in bytes of column I of range `a` of records: computed if trivial,
+// otherwise by a dry run
+
+template<size_t I, typename A, only_if<is_triv<member<A, field_of<I>>>{}> = 0>
+uint64_t column_size(const A& a) { return size(a) * sizeof(member<A, field_of<I>>); }
+
+template<size_t I, typename A, only_if<!is_triv<member<A, field_of<I>>>{}> = 0>
+uint64_t column_size(const A& a) { counter c; w_member<field_of<I>>(c, a); return c.n; }
+
+//-----------------------------------------------------------------------------
+// read column I into field I of all records of range `a`, already resized;
+// staged through a buffer of bounded size if trivial
+
+template<size_t I, typename S, typename A, only_if<is_triv<member<A, field_of<I>>>{}> = 0>
+void r_column(S& s, A& a)
+{
+	using T = member<A, field_of<I>>;
+	size_t n = size(a), m = std::min(n, stage_len<T>());
+	std::unique_ptr<T[]> b(new T[m]);
+	for(auto i = std::begin(a), e = std::end(a); i != e;)
+	{
+		size_t k = std::min(n, m);
+		r_mem(s, b.get(), k);
+		for(size_t j = 0; j < k; ++i, ++j) std::get<I>(fields_of(*i)) = b[j];
+		n -= k;
+	}
+}
+
+template<size_t I, typename S, typename A, only_if<!is_triv<member<A, field_of<I>>>{}> = 0>
+void r_column(S& s, A& a) { for(auto& x : a) xread(s, std::get<I>(fields_of(x))); }
+
+//-----------------------------------------------------------------------------
+// column directory: sizes of all columns and their positions in the stream,
+// with that of the end of the last column appended; trivial columns of
+// record type T are checked against `n` records
+
+template<typename T, size_t... I>
+void r_column_check(const std::vector<uint64_t>& len, uint64_t n, seq<I...>)
+{
+	using R = fields<T>;
+	bool ok = len.size() == sizeof...(I);
+	using e = int[];
+	(void)e{0, (ok = ok && (!is_triv<field<I, R>>{} || len[I] == n * sizeof(field<I, R>)), 0)...};
+	if(!ok) throw e_columns();
+}
+
+template<typename S>
+std::vector<std::streamoff> r_column_dir(S& s, uint64_t& n, std::vector<uint64_t>& len)
+{
+	xread(s, n); xread(s, len);
+	std::vector<std::streamoff> at(1, s.tellg());
+	for(uint64_t k : len) at.push_back(at.back() + std::streamoff(k));
+	return at;
+}
+
+template<typename S>
+void r_column_at(S& s, std::streamoff p) { if(s.tellg() != p) s.seekg(p); }
+
+//-----------------------------------------------------------------------------
+// columnar serialization
+
+template<typename S, typename A, size_t... I>
+void r_columns(S& s, const columns_t<A>& c, seq<I...>)
+{
+	using T = elem<A>;
+	XIO_STATS_PATH(record);
+
+	uint64_t n;
+	std::vector<uint64_t> len;
+	std::vector<std::streamoff> at = r_column_dir(s, n, len);
+	if(!s) return;
+	r_column_check<T>(len, n, seq<I...>());
+
+	std::vector<bool> read(sizeof...(I), c.which.empty());
+	for(size_t i : c.which)
+		if(i < read.size()) read[i] = true; else throw e_columns();
+
+	A& a = c.a;
+	a.clear(); a.resize(n);
+	using e = int[];
+	(void)e{0, (read[I] ? (r_column_at(s, at[I]), r_column<I>(s, a), 0) : 0)...};
+	r_column_at(s, at.back());
+}
+
+template<typename S, typename A, size_t... I>
+void w_columns(S& s, const columns_t<A>& c, seq<I...>)
+{
+	XIO_STATS_PATH(record);
+
+	const A& a = c.a;
+	std::vector<uint64_t> len{column_size<I>(a)...};
+	xwrite(s, uint64_t(size(a))); xwrite(s, len);
+	using e = int[];
+	(void)e{0, (w_member<field_of<I>>(s, a), 0)...};
+}
+
+template<typename S, typename A>
+void xread(S& s, const columns_t<A>& c)
+{
+	using T = elem<A>;
+	static_assert(has_fields<T>(), "Columnar layout only supported for ranges of records with fields.");
+	r_columns(s, c, make_seq<field_count<fields<T>>{}>());
+}
+
+template<typename S, typename A>
+void xwrite(S& s, const columns_t<A>& c)
+{
+	using T = elem<A>;
+	static_assert(has_fields<T>(), "Columnar layout only supported for ranges of records with fields.");
+	w_columns(s, c, make_seq<field_count<fields<const T>>{}>());
+}
+
+//-----------------------------------------------------------------------------
+// read column `i` into range `a` as `n` elements, checking size `k` in bytes
+// if trivial
+
+template<typename S, typename A>
+void r_column_to(S& s, A& a, uint64_t n, uint64_t k)
+{
+	if(is_triv<elem<A>>() && k != n * sizeof(elem<A>)) throw e_columns();
+	resize(a, n); r_elem(s, a, n);
+}
+
+template<typename S, typename... C, size_t... J>
+void r_column_ranges(S& s, const column_ranges_t<C...>& c, seq<J...>)
+{
+	XIO_STATS_PATH(record);
+
+	uint64_t n;
+	std::vector<uint64_t> len;
+	std::vector<std::streamoff> at = r_column_dir(s, n, len);
+	if(!s) return;
+	if(c.which.size() != sizeof...(C)) throw e_columns();
+	for(size_t i : c.which) if(i >= len.size()) throw e_columns();
+
+	using e = int[];
+	(void)e{0, (r_column_at(s, at[c.which[J]]),
+		r_column_to(s, std::get<J>(c.c), n, len[c.which[J]]), 0)...};
+	r_column_at(s, at.back());
+}
+
+template<typename S, typename... C>
+void xread(S& s, const column_ranges_t<C...>& c)
+{
+	r_column_ranges(s, c, make_seq<sizeof...(C)>());
+}
+
+//-----------------------------------------------------------------------------
+
+}  // namespace xio_details
+
+//-----------------------------------------------------------------------------
+
+using xio_details::columns;
+using xio_details::column_ranges;
+using xio_details::xread;
+using xio_details::xwrite;
+
+//-----------------------------------------------------------------------------
+
+}  // namespace xio
+
+//-----------------------------------------------------------------------------
+
+#endif // XIO_COLUMNS
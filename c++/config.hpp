@@ -1,4 +1,6 @@
 #include <array>
+#include <bitset>
+#include <deque>
 #include <vector>
 #include <string>
 
@@ -14,6 +16,16 @@ namespace xio {
 
 constexpr size_t buffer_size() { return 1 << 16; }
 
+// size of buffer in bytes for staging the elements of non-contiguous ranges
+constexpr size_t stage_size() { return buffer_size(); }
+
+// size of blocks in bytes of uncompressed data, compressed independently
+constexpr size_t pack_size() { return 1 << 20; }
+
+// size of blocks in bytes of data following a file header, checksummed
+// independently
+constexpr size_t check_size() { return 1 << 20; }
+
 template<typename S, typename T>
 void setbuf(S& s, typename S::char_type* b, T n) { s.rdbuf()->pubsetbuf(b, n); }
 
@@ -28,13 +40,35 @@ std::true_type is_contiguous(const T(&)[N]);
 template<typename T, size_t N>
 std::true_type is_contiguous(const std::array<T,N>&);
 
-template<typename T>
-std::true_type is_contiguous(const std::vector<T>&);
+template<typename T, typename A>
+std::true_type is_contiguous(const std::vector<T,A>&);
+
+template<typename A>
+std::false_type is_contiguous(const std::vector<bool,A>&);
+
+template<typename C, typename T, typename A>
+std::true_type is_contiguous(const std::basic_string<C,T,A>&);
+
+//-----------------------------------------------------------------------------
+// segmented container configuration: non-contiguous containers whose
+// elements are stored in contiguous segments, each copied directly
+
+std::false_type is_segmented(...);
+
+template<typename T, typename A>
+std::true_type is_segmented(const std::deque<T,A>&);
+
+//-----------------------------------------------------------------------------
+// bit container configuration: containers of bits, serialized packed, 8 bits
+// per byte; either ranges or fixed-size, non-range types
+
+std::false_type is_bitwise(...);
 
-std::false_type is_contiguous(const std::vector<bool>&);
+template<typename A>
+std::true_type is_bitwise(const std::vector<bool,A>&);
 
-template<typename C, typename T>
-std::true_type is_contiguous(const std::basic_string<C,T>&);
+template<size_t N>
+std::true_type is_bitwise(const std::bitset<N>&);
 
 //-----------------------------------------------------------------------------
 
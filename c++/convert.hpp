@@ -0,0 +1,303 @@
+#include <cfloat>
+#include <limits>
+
+#ifndef XIO_CONVERT
+#define XIO_CONVERT
+
+//-----------------------------------------------------------------------------
+
+namespace xio {
+
+//-----------------------------------------------------------------------------
+// options of loading with type conversion: stored scalar type, if not
+// recorded in the file header nor named by the file extension; and
+// saturation of values out of range of the target type
+
+struct convert
+{
+	bool saturate;  // clamp to target range, NaN to zero for integers
+	scalar from;    // stored type; none to detect
+
+	convert(bool saturate = false, scalar from = scalar::none) :
+		saturate(saturate), from(from) {}
+};
+
+//-----------------------------------------------------------------------------
+
+namespace xio_details {
+
+//-----------------------------------------------------------------------------
+// conversion of scalar `x` of type U to type T, saturating
+
+template<typename T, typename U,
+	only_if<std::is_floating_point<T>{} && std::is_floating_point<U>{}> = 0>
+T sat_cast(U x)
+{
+	using L = std::numeric_limits<T>;
+	return x < U(L::lowest()) ? L::lowest() : x > U(L::max()) ? L::max() : T(x);
+}
+
+template<typename T, typename U,
+	only_if<std::is_floating_point<T>{} && std::is_integral<U>{}> = 0>
+T sat_cast(U x) { return T(x); }
+
+template<typename T, typename U,
+	only_if<std::is_integral<T>{} && std::is_floating_point<U>{}> = 0>
+T sat_cast(U x)
+{
+	using L = std::numeric_limits<T>;
+	return x != x ? T(0) : x <= U(L::min()) ? L::min() : x >= U(L::max()) ? L::max() : T(x);
+}
+
+template<typename T, typename U,
+	only_if<std::is_integral<T>{} && std::is_integral<U>{}> = 0>
+T sat_cast(U x)
+{
+	using L = std::numeric_limits<T>;
+	return x < U(0) ? (intmax_t(x) < intmax_t(L::min()) ? L::min() : T(x)) :
+		uintmax_t(x) > uintmax_t(L::max()) ? L::max() : T(x);
+}
+
+//-----------------------------------------------------------------------------
+// convert `n` scalars from `s` to `d`; scalar version. Integers are narrowed
+// modulo the target range and floating point numbers are truncated towards
+// zero, where values out of the target range are undefined unless saturating
+
+template<typename U, typename T>
+void conv_sc(const U* s, T* d, size_t n, bool sat)
+{
+	if(sat) for(size_t i = 0; i < n; ++i) d[i] = sat_cast<T>(s[i]);
+	else for(size_t i = 0; i < n; ++i) d[i] = T(s[i]);
+}
+
+//-----------------------------------------------------------------------------
+// vectorized versions for common pairs of types, converting a multiple of
+// the vector width; return number of scalars converted, zero if there is no
+// vectorized version. Saturation keeps NaN like the scalar version.
+
+#ifdef XIO_X86
+
+template<typename U, typename T>
+size_t conv_avx2(const U*, T*, size_t, bool) { return 0; }
+
+XIO_TARGET("avx2")
+inline size_t conv_avx2(const double* s, float* d, size_t n, bool sat)
+{
+	const __m256d lo = _mm256_set1_pd(-FLT_MAX), hi = _mm256_set1_pd(FLT_MAX);
+	size_t i = 0;
+	for(; i + 4 <= n; i += 4)
+	{
+		__m256d x = _mm256_loadu_pd(s + i);
+		if(sat) x = _mm256_min_pd(hi, _mm256_max_pd(lo, x));
+		_mm_storeu_ps(d + i, _mm256_cvtpd_ps(x));
+	}
+	return i;
+}
+
+XIO_TARGET("avx2")
+inline size_t conv_avx2(const float* s, double* d, size_t n, bool)
+{
+	size_t i = 0;
+	for(; i + 4 <= n; i += 4)
+		_mm256_storeu_pd(d + i, _mm256_cvtps_pd(_mm_loadu_ps(s + i)));
+	return i;
+}
+
+XIO_TARGET("avx2")
+inline size_t conv_avx2(const int32_t* s, double* d, size_t n, bool)
+{
+	size_t i = 0;
+	for(; i + 4 <= n; i += 4)
+	{
+		__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+		_mm256_storeu_pd(d + i, _mm256_cvtepi32_pd(x));
+	}
+	return i;
+}
+
+XIO_TARGET("avx2")
+inline size_t conv_avx2(const int32_t* s, float* d, size_t n, bool)
+{
+	size_t i = 0;
+	for(; i + 8 <= n; i += 8)
+	{
+		__m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i));
+		_mm256_storeu_ps(d + i, _mm256_cvtepi32_ps(x));
+	}
+	return i;
+}
+
+// 8 narrow integers of type U, loaded from `s` and widened to int32
+template<typename U>
+XIO_TARGET("avx2")
+__m256i widen8(const U* s)
+{
+	__m128i x = sizeof(U) == 1 ?
+		_mm_loadl_epi64(reinterpret_cast<const __m128i*>(s)) :
+		_mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+	return sizeof(U) == 1 ?
+		(std::is_signed<U>{} ? _mm256_cvtepi8_epi32(x) : _mm256_cvtepu8_epi32(x)) :
+		(std::is_signed<U>{} ? _mm256_cvtepi16_epi32(x) : _mm256_cvtepu16_epi32(x));
+}
+
+template<typename U>
+XIO_TARGET("avx2")
+size_t conv_narrow_avx2(const U* s, float* d, size_t n)
+{
+	size_t i = 0;
+	for(; i + 8 <= n; i += 8) _mm256_storeu_ps(d + i, _mm256_cvtepi32_ps(widen8(s + i)));
+	return i;
+}
+
+inline size_t conv_avx2(const uint8_t* s, float* d, size_t n, bool) { return conv_narrow_avx2(s, d, n); }
+inline size_t conv_avx2(const int8_t* s, float* d, size_t n, bool) { return conv_narrow_avx2(s, d, n); }
+inline size_t conv_avx2(const uint16_t* s, float* d, size_t n, bool) { return conv_narrow_avx2(s, d, n); }
+inline size_t conv_avx2(const int16_t* s, float* d, size_t n, bool) { return conv_narrow_avx2(s, d, n); }
+
+XIO_TARGET("avx2")
+inline size_t conv_avx2(const float* s, int32_t* d, size_t n, bool sat)
+{
+	const __m256 hi = _mm256_set1_ps(2147483648.f);
+	const __m256i max = _mm256_set1_epi32(INT32_MAX);
+	size_t i = 0;
+	for(; i + 8 <= n; i += 8)
+	{
+		__m256 x = _mm256_loadu_ps(s + i);
+		__m256i y = _mm256_cvttps_epi32(x);
+		if(sat)
+		{
+			// out of range yields INT32_MIN, which is right for negatives only
+			y = _mm256_blendv_epi8(y, max, _mm256_castps_si256(_mm256_cmp_ps(x, hi, _CMP_GE_OQ)));
+			y = _mm256_and_si256(y, _mm256_castps_si256(_mm256_cmp_ps(x, x, _CMP_ORD_Q)));
+		}
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(d + i), y);
+	}
+	return i;
+}
+
+#endif
+
+//-----------------------------------------------------------------------------
+// convert `n` scalars from `s` to `d`, using the fastest version available
+
+template<typename U, typename T>
+void conv(const U* s, T* d, size_t n, bool sat)
+{
+	size_t i = 0;
+#ifdef XIO_X86
+	if(has_avx2()) i = conv_avx2(s, d, n, sat);
+#endif
+	conv_sc(s + i, d + i, n - i, sat);
+}
+
+//-----------------------------------------------------------------------------
+// read `n` stored scalars of type U into range `a` of scalars, whose
+// dimensions have been read, converting in chunks staged through a buffer of
+// bounded size; directly into `a` if contiguous, otherwise followed by
+// insertion
+
+template<typename U, typename S, typename A, only_if<is_contig<A>{}> = 0>
+void r_conv(S& s, A& a, size_t n, bool sat)
+{
+	XIO_STATS_PATH(staged);
+	if(!n) return;
+	raw_vector<U> b(std::min(n, stage_len<U>()));
+	auto d = base(a);
+	for(size_t k; n; n -= k, d += k)
+	{
+		k = std::min(n, b.size());
+		r_mem(s, b.data(), k);
+		conv(b.data(), d, k, sat);
+	}
+}
+
+template<typename U, typename S, typename A, only_if<!is_contig<A>{}> = 0>
+void r_conv(S& s, A& a, size_t n, bool sat)
+{
+	XIO_STATS_PATH(staged);
+	using T = elem<A>;
+	raw_vector<U> b(std::min(n, stage_len<U>()));
+	raw_vector<T> c(b.size());
+	for(size_t k; n; n -= k)
+	{
+		k = std::min(n, b.size());
+		r_mem(s, b.data(), k);
+		conv(b.data(), c.data(), k, sat);
+		insert(a, c.data(), c.data() + k);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// read range `a` of scalars, stored as scalars of type `t`: dimensions as
+// usual, followed by elements converted, or read as usual if of the same type
+
+template<typename A>
+struct conv_reader
+{
+	A& a;
+	scalar t;
+	bool sat;
+
+	template<typename S>
+	void operator()(S& s) const
+	{
+		size_t n = r_dims(_true(), s, a);
+		if(t == scalar_of<elem<A>>()) return r_elem(s, a, n);
+		switch(t)
+		{
+			case scalar::u1: return r_conv<uint8_t>(s, a, n, sat);
+			case scalar::u2: return r_conv<uint16_t>(s, a, n, sat);
+			case scalar::u4: return r_conv<uint32_t>(s, a, n, sat);
+			case scalar::u8: return r_conv<uint64_t>(s, a, n, sat);
+			case scalar::i1: return r_conv<int8_t>(s, a, n, sat);
+			case scalar::i2: return r_conv<int16_t>(s, a, n, sat);
+			case scalar::i4: return r_conv<int32_t>(s, a, n, sat);
+			case scalar::i8: return r_conv<int64_t>(s, a, n, sat);
+			case scalar::f4: return r_conv<float>(s, a, n, sat);
+			case scalar::f8: return r_conv<double>(s, a, n, sat);
+			case scalar::none: return r_elem(s, a, n);
+		}
+	}
+};
+
+//-----------------------------------------------------------------------------
+// load range `a` of scalars from file `f` holding it as its first object,
+// converting from the stored scalar type on the fly: as given in `c`, or
+// else as recorded in the file header, or else as named by the file
+// extension, e.g. `.f8` for double (see type_info.m of xio/matlab); if none
+// of these, the stored type is taken to be that of `a`
+
+template<>
+struct is_option<convert> : _true {};
+
+template<typename F, typename A>
+void xload(const convert& c, const F& f, A& a)
+{
+	static_assert(is_range<A>() && scalar_of<elem<A>>() != scalar::none,
+		"Conversion only supported for ranges of scalars.");
+	XIO_STATS_CALL("load");
+
+	std::vector<char> u(buffer_size());
+	std::ifstream s;
+	header h;
+	xopen(s, f, u); r_head(s, h, f);
+	scalar t = c.from != scalar::none ? c.from : h.type ? scalar(h.type) : scalar_ext(c_str(f));
+	if(t == scalar::none) t = scalar_of<elem<A>>();
+	if(!r_with(s, h, conv_reader<A>{a, t, c.saturate})) throw e_read(f);
+}
+
+//-----------------------------------------------------------------------------
+
+}  // namespace xio_details
+
+//-----------------------------------------------------------------------------
+
+using xio_details::xload;
+
+//-----------------------------------------------------------------------------
+
+}  // namespace xio
+
+//-----------------------------------------------------------------------------
+
+#endif // XIO_CONVERT
@@ -0,0 +1,222 @@
+#include <future>
+
+#ifndef XIO_CURSOR
+#define XIO_CURSOR
+
+//-----------------------------------------------------------------------------
+
+namespace xio {
+
+//-----------------------------------------------------------------------------
+
+namespace xio_details {
+
+//-----------------------------------------------------------------------------
+// number of elements per slice in the last dimension, i.e. product of all
+// dimensions but the last; one for one-dimensional arrays
+
+inline size_t slice_len(const std::vector<size_t>& n)
+{
+	size_t p = 1;
+	for(size_t i = 0; i + 1 < n.size(); ++i) p *= n[i];
+	return p;
+}
+
+//-----------------------------------------------------------------------------
+// cursor reading an array of trivial elements T with dimensions D (a size
+// for one-dimensional arrays) from a file in successive blocks, each into
+// the same buffer, so that arrays of any size are processed in constant
+// memory. The next block is read ahead on another thread while the current
+// one is processed. The array should be the first object in the file, with
+// or without a header of any format; checksums are not verified.
+
+template<typename T, typename D = size_t>
+class array_reader
+{
+	static_assert(is_triv<T>(), "Only trivially copyable elements can be read in blocks.");
+
+	using S = std::ifstream;
+
+	std::string f;
+	std::vector<char> u;
+	S s;
+	std::unique_ptr<pack_istream<S>> p;
+	std::unique_ptr<swap_istream<S>> w;
+	std::unique_ptr<swap_istream<pack_istream<S>>> pw;
+	std::function<bool(T*, size_t)> in;
+	D d;
+	size_t len, slice, left, at, blk;
+	raw_vector<T> cur, ahead;
+	std::future<void> pending;
+
+	template<typename R>
+	void init(R& r)
+	{
+		xread(r, d);
+		if(!r) throw e_read(f);
+		in = [&r](T* b, size_t k) { r_mem(r, b, k); return bool(r); };
+	}
+
+	size_t take() { size_t k = std::min(blk, left); left -= k; return k; }
+
+	void fill(raw_vector<T>& b, size_t k)
+	{
+		b.resize(k);
+		if(k && !in(b.data(), k)) throw e_read(f);
+	}
+
+public:
+	// blocks of `n` elements, or of a default size of about buffer_size()
+	// bytes if zero
+	template<typename F>
+	array_reader(const F& f, size_t n = 0) : f(c_str(f)), u(buffer_size()), at(0)
+	{
+		header h;
+		xopen(s, f, u); r_head(s, h, f); r_head_type<T>(h, f);
+		if(h.packed())
+		{
+			p.reset(new pack_istream<S>(s));
+			if(h.swapped()) { pw.reset(new swap_istream<pack_istream<S>>(*p)); init(*pw); }
+			else init(*p);
+		}
+		else if(h.swapped()) { w.reset(new swap_istream<S>(s)); init(*w); }
+		else init(s);
+
+		std::vector<size_t> m = dim_vec(d);
+		len = left = total(m);
+		slice = slice_len(m);
+		block(n);
+	}
+
+	array_reader(const array_reader&) = delete;
+
+	~array_reader() { if(pending.valid()) pending.wait(); }
+
+	// dimensions, total number of elements, and elements per slice in the
+	// last dimension
+	const D& dims() const { return d; }
+	size_t size() const { return len; }
+	size_t slice_size() const { return slice; }
+
+	// elements returned so far; true if all returned
+	size_t tell() const { return at; }
+	bool done() const { return at == len; }
+
+	// set block size to `n` elements or `k` slices in the last dimension;
+	// takes effect after the block that is already read ahead, if any
+	void block(size_t n) { blk = n ? n : std::max(stage_len<T>(), size_t(1)); }
+	void slices(size_t k) { block(std::max(k, size_t(1)) * slice); }
+
+	// next block, empty at end; valid until next call
+	const raw_vector<T>& next()
+	{
+		if(pending.valid()) { pending.get(); std::swap(cur, ahead); }
+		else fill(cur, take());
+		at += cur.size();
+		if(left)
+		{
+			size_t k = take();
+			pending = std::async(std::launch::async, [this, k] { fill(ahead, k); });
+		}
+		return cur;
+	}
+};
+
+//-----------------------------------------------------------------------------
+// writer of an array of trivial elements T with dimensions D to a file, by
+// appending blocks of elements; dimensions are written on opening, where
+// the last one is ignored, and are patched on closing according to the
+// number of elements appended, which should be a multiple of the slice size.
+// Only uncompressed formats without checksums are supported.
+
+template<typename T, typename D = size_t>
+class array_writer
+{
+	static_assert(is_triv<T>(), "Only trivially copyable elements can be written in blocks.");
+
+	using S = std::ofstream;
+
+	std::string f;
+	std::vector<char> u;
+	S s;
+	std::unique_ptr<swap_ostream<S>> w;
+	std::function<void(const T*, size_t)> out;
+	std::function<void()> out_dims;
+	D d;
+	std::streamoff at;
+	size_t len;
+	bool open;
+
+	template<typename R>
+	void init(R& r)
+	{
+		at = s.tellp();
+		xwrite(r, d);
+		out = [&r](const T* b, size_t k) { w_mem(r, b, k); };
+		out_dims = [this, &r] { s.seekp(at); xwrite(r, d); };
+	}
+
+public:
+	template<typename F>
+	array_writer(const F& f, const D& d = D()) :
+		f(c_str(f)), u(buffer_size()), d(d), len(0), open(true)
+	{
+		xopen(s, f, u); init(s);
+	}
+
+	template<typename F>
+	array_writer(const format& x, const F& f, const D& d = D()) :
+		f(c_str(f)), u(buffer_size()), d(d), len(0), open(true)
+	{
+		if(x.pack != codec::none || x.check != checksum::none) throw e_format(f);
+		counter c;
+		xwrite(c, d);
+		xopen(s, f, u); w_head_dims(s, x, c.n, scalar_of<T>());
+		if(swapped(x.order)) { w.reset(new swap_ostream<S>(s)); init(*w); }
+		else init(s);
+	}
+
+	array_writer(const array_writer&) = delete;
+
+	~array_writer() { if(open) try { close(); } catch(...) {} }
+
+	// elements appended so far
+	size_t size() const { return len; }
+
+	// append `n` elements at `b`, or contiguous range `r`
+	void append(const T* b, size_t n) { out(b, n); len += n; }
+
+	template<typename R>
+	void append(const R& r) { append(base(r), xio_details::size(r)); }
+
+	// patch dimensions and close file, throwing on failure
+	void close()
+	{
+		open = false;
+		std::vector<size_t> m = dim_vec(d);
+		size_t q = slice_len(m);
+		if(m.empty() || (q ? len % q : len)) throw e_format(f);
+		m.back() = q ? len / q : 0;
+		dim_set(d, m);
+		out_dims();
+		s.close();
+		if(!s) throw e_write(f);
+	}
+};
+
+//-----------------------------------------------------------------------------
+
+}  // namespace xio_details
+
+//-----------------------------------------------------------------------------
+
+using xio_details::array_reader;
+using xio_details::array_writer;
+
+//-----------------------------------------------------------------------------
+
+}  // namespace xio
+
+//-----------------------------------------------------------------------------
+
+#endif // XIO_CURSOR
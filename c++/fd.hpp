@@ -0,0 +1,345 @@
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <new>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#ifndef XIO_FD
+#define XIO_FD
+
+//-----------------------------------------------------------------------------
+
+namespace xio {
+
+//-----------------------------------------------------------------------------
+// options of file descriptor streams: buffer size in bytes; bypass page
+// cache by direct I/O (O_DIRECT); drop file from page cache on closing
+
+struct posix
+{
+	size_t buffer;
+	bool direct;
+	bool drop;
+
+	posix(size_t buffer = 1 << 22, bool direct = false, bool drop = false) :
+		buffer(buffer), direct(direct), drop(drop) {}
+};
+
+//-----------------------------------------------------------------------------
+
+namespace xio_details {
+
+//-----------------------------------------------------------------------------
+// alignment of buffers, file offsets and sizes for direct I/O
+
+constexpr size_t block_size() { return 1 << 12; }
+
+//-----------------------------------------------------------------------------
+// system calls, possibly unavailable; complete transfers unless at end of
+// file or on error, returning number of bytes transferred
+
+inline void advise_seq(int fd)
+{
+#ifdef POSIX_FADV_SEQUENTIAL
+	::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+}
+
+inline void advise_drop(int fd)
+{
+#ifdef POSIX_FADV_DONTNEED
+	::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+#endif
+}
+
+inline void allocate(int fd, size_t n)
+{
+#ifdef __linux__
+	::fallocate(fd, 0, 0, n);
+#endif
+}
+
+inline size_t pread_all(int fd, char* p, size_t n, off_t o)
+{
+	size_t k = 0;
+	while(k < n)
+	{
+		ssize_t r = ::pread(fd, p + k, n - k, o + k);
+		if(r > 0) k += r;
+		else if(r == 0 || errno != EINTR) break;
+	}
+	return k;
+}
+
+inline size_t pwrite_all(int fd, const char* p, size_t n, off_t o)
+{
+	size_t k = 0;
+	while(k < n)
+	{
+		ssize_t r = ::pwrite(fd, p + k, n - k, o + k);
+		if(r > 0) k += r;
+		else if(r == 0 || errno != EINTR) break;
+	}
+	return k;
+}
+
+//-----------------------------------------------------------------------------
+// file descriptor stream base: file descriptor, options and aligned buffer
+
+class fd_stream
+{
+	struct del { void operator()(char* p) { std::free(p); } };
+
+protected:
+	posix opt;
+	int fd;
+	bool ok;
+	size_t cap;
+	std::unique_ptr<char, del> buf;
+
+	fd_stream(const posix& o) : opt(o), fd(-1), ok(false),
+		cap(round_up(std::max(o.buffer, block_size()), block_size()))
+	{
+		void* p = nullptr;
+		if(::posix_memalign(&p, block_size(), cap)) throw std::bad_alloc();
+		buf.reset(static_cast<char*>(p));
+	}
+
+	~fd_stream() { release(); }
+
+	template<typename F>
+	void open(const F& f, int flags)
+	{
+		release();
+#ifdef O_DIRECT
+		if(opt.direct) flags |= O_DIRECT;
+#endif
+		fd = ::open(c_str(f), flags, 0666);
+		ok = fd >= 0;
+		if(ok) advise_seq(fd);
+	}
+
+	void release()
+	{
+		if(fd < 0) return;
+		if(opt.drop) advise_drop(fd);
+		::close(fd); fd = -1;
+	}
+
+public:
+	using char_type = char;
+
+	fd_stream(const fd_stream&) = delete;
+	fd_stream& operator=(const fd_stream&) = delete;
+
+	int handle() const { return fd; }
+	bool is_open() const { return fd >= 0; }
+	explicit operator bool() const { return ok; }
+	bool operator!() const { return !ok; }
+	void clear() { ok = is_open(); }
+};
+
+//-----------------------------------------------------------------------------
+// input file descriptor stream; reads at least as large as the buffer go
+// directly to their destination, unless in direct I/O mode
+
+class fd_istream : public fd_stream
+{
+	off_t pos;   // file position of buffer
+	size_t i;    // read position in buffer
+	size_t n;    // data length in buffer
+	std::streamsize cnt;
+
+	void fill()
+	{
+		off_t q = tellg(), a = opt.direct ? q / block_size() * block_size() : q;
+		n = pread_all(fd, buf.get(), cap, a);
+		pos = a; i = q - a;
+	}
+
+public:
+	fd_istream(const posix& o = posix()) : fd_stream(o), pos(0), i(0), n(0), cnt(0) {}
+
+	template<typename F>
+	fd_istream(const F& f, const posix& o = posix()) : fd_istream(o) { open(f); }
+
+	template<typename F>
+	void open(const F& f, std::ios_base::openmode = std::ios_base::in)
+	{
+		fd_stream::open(f, O_RDONLY); pos = i = n = 0;
+	}
+
+	void close() { release(); ok = false; }
+
+	fd_istream& read(char_type* p, std::streamsize k)
+	{
+		for(cnt = 0; ok && k;)
+		{
+			if(i == n && !opt.direct && size_t(k) >= cap)
+			{
+				size_t r = pread_all(fd, p, k, tellg());
+				pos += i + r; i = n = 0; cnt += r;
+				ok = r == size_t(k); break;
+			}
+			if(i == n) fill();
+			if(i >= n) { ok = false; break; }
+			size_t m = std::min(size_t(k), n - i);
+			std::memcpy(p, buf.get() + i, m);
+			i += m; p += m; k -= m; cnt += m;
+		}
+		return *this;
+	}
+
+	std::streamsize gcount() const { return cnt; }
+	std::streamoff tellg() const { return pos + i; }
+
+	fd_istream& seekg(std::streamoff q)
+	{
+		if(q >= pos && q <= off_t(pos + n)) i = q - pos;
+		else { pos = q; i = n = 0; }
+		return *this;
+	}
+
+	fd_istream& seekg(std::streamoff q, std::ios_base::seekdir d)
+	{
+		struct stat st;
+		if(d == std::ios_base::cur) q += tellg();
+		else if(d == std::ios_base::end) q += ::fstat(fd, &st) ? 0 : st.st_size;
+		return seekg(q);
+	}
+};
+
+//-----------------------------------------------------------------------------
+// output file descriptor stream; writes at least as large as the buffer go
+// directly to file, unless in direct I/O mode; space may be reserved for
+// known file size
+
+class fd_ostream : public fd_stream
+{
+	off_t pos;   // file position of buffer
+	size_t n;    // data length in buffer
+	size_t res;  // reserved file size
+
+	// direct I/O is turned off before writing at unaligned offset or size,
+	// e.g. a partial block on seeking, skipping, syncing or closing
+	void flush(size_t k)
+	{
+#ifdef O_DIRECT
+		if(opt.direct && k && (pos % block_size() || k % block_size()))
+		{
+			::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) & ~O_DIRECT);
+			opt.direct = false;
+		}
+#endif
+		ok = ok && pwrite_all(fd, buf.get(), k, pos) == k;
+		pos += k; n = 0;
+	}
+
+public:
+	fd_ostream(const posix& o = posix()) : fd_stream(o), pos(0), n(0), res(0) {}
+
+	template<typename F>
+	fd_ostream(const F& f, const posix& o = posix()) : fd_ostream(o) { open(f); }
+
+	~fd_ostream() { close(); }
+
+	// existing file is truncated, unless opened for input as well
+	template<typename F>
+	void open(const F& f, std::ios_base::openmode m = std::ios_base::out)
+	{
+		bool keep = (m & std::ios_base::in) && !(m & std::ios_base::trunc);
+		fd_stream::open(f, O_WRONLY | O_CREAT | (keep ? 0 : O_TRUNC)); pos = n = res = 0;
+	}
+
+	void reserve(size_t size) { if(ok) { allocate(fd, size); res = size; } }
+
+	fd_ostream& write(const char_type* p, std::streamsize k)
+	{
+		while(ok && k)
+		{
+			if(n == 0 && !opt.direct && size_t(k) >= cap)
+			{
+				ok = pwrite_all(fd, p, k, pos) == size_t(k);
+				pos += k; break;
+			}
+			size_t m = std::min(size_t(k), cap - n);
+			std::memcpy(buf.get() + n, p, m);
+			n += m; p += m; k -= m;
+			if(n == cap) flush(n);
+		}
+		return *this;
+	}
+
+	std::streamoff tellp() const { return pos + n; }
+
+	fd_ostream& seekp(std::streamoff q) { flush(n); pos = q; return *this; }
+
+	// write buffered data and wait until they are stored on device
+	fd_ostream& sync()
+	{
+		flush(n);
+		if(ok && ::fdatasync(fd)) ok = false;
+		return *this;
+	}
+
+	// skip `k` bytes, to be written by other means
+	void skip(size_t k) { flush(n); pos += k; }
+
+	void close()
+	{
+		if(!is_open()) return;
+		flush(n);
+		if(res > size_t(pos) && ::ftruncate(fd, pos)) ok = false;
+		if(opt.drop) ::fdatasync(fd);
+		release();
+	}
+};
+
+//-----------------------------------------------------------------------------
+// file operations as in io.hpp, using file descriptor streams with given
+// options; on saving, file space is reserved in advance after a dry run
+
+template<>
+struct is_option<posix> : _true {};
+
+template<typename F, typename A, typename... B>
+void xload(const posix& o, const F& f, A& a, B&... b)
+{
+	XIO_STATS_CALL("load");
+	fd_istream s(o);
+	xopen(s, f);
+	if(!r_file(s, f, a, b...)) throw e_read(f);
+}
+
+template<typename F, typename A, typename... B>
+void xsave(const posix& o, const F& f, const A& a, const B&... b)
+{
+	XIO_STATS_CALL("save");
+	fd_ostream s(o);
+	counter c;
+	xwrite(c, a, b...);
+	xopen(s, f); s.reserve(c.n); xwrite(s, a, b...);
+	s.close();
+	if(!s) throw e_write(f);
+}
+
+//-----------------------------------------------------------------------------
+
+}  // namespace xio_details
+
+//-----------------------------------------------------------------------------
+
+using xio_details::fd_istream;
+using xio_details::fd_ostream;
+using xio_details::xload;
+using xio_details::xsave;
+
+//-----------------------------------------------------------------------------
+
+}  // namespace xio
+
+//-----------------------------------------------------------------------------
+
+#endif // XIO_FD
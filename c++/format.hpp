@@ -0,0 +1,185 @@
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+#ifndef XIO_FORMAT
+#define XIO_FORMAT
+
+//-----------------------------------------------------------------------------
+
+namespace xio {
+
+//-----------------------------------------------------------------------------
+// file format options; a file header is written only when these are
+// given explicitly, otherwise files contain serialized objects only
+
+enum class endian { native, little, big };
+
+enum class codec { none, packed };
+
+// element type of scalars, as named by file extensions, e.g. `.f4` for float
+// or `.u1` for uint8_t; none if not a scalar or unknown
+
+enum class scalar { none, u1, u2, u4, u8, i1, i2, i4, i8, f4, f8 };
+
+// integrity check of data following the header
+enum class checksum { none, crc32c };
+
+struct format
+{
+	size_t align;  // alignment of first object payload in bytes; 0 for none
+	endian order;  // byte order of scalars
+	codec pack;    // compression of objects in blocks; alignment is ignored
+	checksum check;  // checksums of data in blocks, stored after the data
+
+	format(size_t align = 0, endian order = endian::native,
+		codec pack = codec::none, checksum check = checksum::none) :
+		align(align), order(order), pack(pack), check(check) {}
+};
+
+//-----------------------------------------------------------------------------
+
+namespace xio_details {
+
+//-----------------------------------------------------------------------------
+// file signature, 8 bytes; read as a 64-bit size, it is way too large to be
+// confused with the first object of a file without header
+
+inline const char* magic() { return "\x89xio\r\n\x1a\n"; }
+
+constexpr uint64_t version() { return 3; }
+
+//-----------------------------------------------------------------------------
+// byte order of this machine, and byte order mark: written in the byte order
+// of a file, it reads differently on machines of different byte order
+
+constexpr bool little()
+{
+	return __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__;
+}
+
+constexpr uint64_t mark() { return 0x0102030405060708; }
+
+inline bool swapped(endian e)
+{
+	return e != endian::native && (e == endian::little) != little();
+}
+
+//-----------------------------------------------------------------------------
+// optional file header; all fields following `sig` are written in the byte
+// order of the file, as indicated by `bom`; `offset` is the position of the
+// first object from the beginning of the file, which may be followed by
+// padding; `type` is the scalar type of the elements of the first object,
+// missing in version 1; `check` is the size in bytes of blocks of data
+// following the header that are checksummed, zero for none, missing before
+// version 3
+
+struct header
+{
+	char     sig[8];
+	uint64_t bom;
+	uint64_t version;
+	uint64_t offset;
+	uint64_t align;
+	uint64_t pack;
+	uint64_t type;
+	uint64_t check;
+
+	header() : bom(mark()), version(xio_details::version()),
+		offset(sizeof(header)), align(0), pack(0), type(0), check(0)
+		{ std::memcpy(sig, magic(), sizeof(sig)); }
+
+	header(const format& x) : header()
+	{
+		align = x.align; pack = uint64_t(x.pack);
+		check = x.check == checksum::none ? 0 : check_size();
+	}
+
+	bool valid() const { return !std::memcmp(sig, magic(), sizeof(sig)); }
+	bool swapped() const { return bom != mark(); }
+	bool packed() const { return pack != uint64_t(codec::none); }
+};
+
+// size of header of given version
+constexpr uint64_t head_size(uint64_t v)
+{
+	return v < 2 ? 48 : v < 3 ? 56 : sizeof(header);
+}
+
+//-----------------------------------------------------------------------------
+// scalar type of T; none if not a scalar
+
+template<typename T, typename = void>
+struct scalar_of_t : std::integral_constant<scalar, scalar::none> {};
+
+template<typename T>
+struct scalar_of_t<T, typename std::enable_if<std::is_integral<T>{} &&
+		!std::is_same<T, bool>{} && sizeof(T) <= 8>::type> :
+	std::integral_constant<scalar, scalar(
+		(std::is_signed<T>{} ? 5 : 1) + (sizeof(T) == 2) + 2 * (sizeof(T) == 4) + 3 * (sizeof(T) == 8))> {};
+
+template<>
+struct scalar_of_t<float> : std::integral_constant<scalar, scalar::f4> {};
+
+template<>
+struct scalar_of_t<double> : std::integral_constant<scalar, scalar::f8> {};
+
+template<typename T>
+constexpr scalar scalar_of() { return scalar_of_t<typename std::remove_cv<T>::type>{}; }
+
+// size in bytes of scalar type; zero if none
+inline size_t scalar_size(scalar t)
+{
+	static const size_t n[] = { 0, 1, 2, 4, 8, 1, 2, 4, 8, 4, 8 };
+	return n[size_t(t)];
+}
+
+//-----------------------------------------------------------------------------
+// scalar type named by extension of file name `f`, with the same aliases as
+// type_info.m of xio/matlab, e.g. `.f8`, `.float64` or `.double`; none if
+// there is no extension or it is unknown
+
+inline scalar scalar_ext(const std::string& f)
+{
+	static const char* n[][4] = {
+		{ "", "", "", "" },
+		{ "u1", "uint8", "uc", "uchar" },
+		{ "u2", "uint16", "us", "ushort" },
+		{ "u4", "uint32", "u", "uint" },
+		{ "u8", "uint64", "ul", "ulong" },
+		{ "i1", "int8", "c", "char" },
+		{ "i2", "int16", "s", "short" },
+		{ "i4", "int32", "i", "int" },
+		{ "i8", "int64", "l", "long" },
+		{ "f4", "float32", "f", "float" },
+		{ "f8", "float64", "d", "double" },
+	};
+	size_t d = f.find_last_of("./");
+	if(d == std::string::npos || f[d] != '.') return scalar::none;
+	std::string x = f.substr(d + 1);
+	if(x == "single") return scalar::f4;
+	for(size_t i = 1; i < sizeof(n) / sizeof(n[0]); ++i)
+		for(const char* a : n[i]) if(x == a) return scalar(i);
+	return scalar::none;
+}
+
+//-----------------------------------------------------------------------------
+// round `n` up to a multiple of `a`; no rounding if `a` is zero
+
+constexpr uint64_t round_up(uint64_t n, uint64_t a)
+{
+	return a ? (n + a - 1) / a * a : n;
+}
+
+//-----------------------------------------------------------------------------
+
+}  // namespace xio_details
+
+//-----------------------------------------------------------------------------
+
+}  // namespace xio
+
+//-----------------------------------------------------------------------------
+
+#endif // XIO_FORMAT
@@ -35,6 +35,56 @@ struct e_open : std::exception
 	const char* what() const noexcept override { return msg.c_str(); }
 };
 
+//-----------------------------------------------------------------------------
+// file write exception
+
+struct e_write : std::exception
+{
+	std::string msg;
+	e_write(const std::string& f) :
+		msg(ss() << "cannot write file " << f << "\n") {}
+	const char* what() const noexcept override { return msg.c_str(); }
+};
+
+//-----------------------------------------------------------------------------
+// file read exception
+
+struct e_read : std::exception
+{
+	std::string msg;
+	e_read(const std::string& f) :
+		msg(ss() << "cannot read file " << f << "\n") {}
+	const char* what() const noexcept override { return msg.c_str(); }
+};
+
+//-----------------------------------------------------------------------------
+// file format exception
+
+struct e_format : std::exception
+{
+	std::string msg;
+	e_format(const std::string& f) :
+		msg(ss() << "invalid format of file " << f << "\n") {}
+	const char* what() const noexcept override { return msg.c_str(); }
+};
+
+//-----------------------------------------------------------------------------
+// reverse byte order of 64-bit integer
+
+inline uint64_t bswap(uint64_t x)
+{
+	x = (x & 0x00000000ffffffff) << 32 | (x & 0xffffffff00000000) >> 32;
+	x = (x & 0x0000ffff0000ffff) << 16 | (x & 0xffff0000ffff0000) >> 16;
+	x = (x & 0x00ff00ff00ff00ff) << 8  | (x & 0xff00ff00ff00ff00) >> 8;
+	return x;
+}
+
+//-----------------------------------------------------------------------------
+// file name as C string, for system calls
+
+inline const char* c_str(const char* f) { return f; }
+inline const char* c_str(const std::string& f) { return f.c_str(); }
+
 //-----------------------------------------------------------------------------
 // array base pointer, only via begin(); this is exactly where abstraction
 // is sacrificed for efficient serialization of contiguous arrays
@@ -51,6 +101,28 @@ size_t size(const A& a) { return std::distance(std::begin(a), std::end(a)); }
 template<typename A, only_if<has_size<A>{}> = 0>
 size_t size(const A& a) { return a.size(); }
 
+//-----------------------------------------------------------------------------
+// number of elements of type T fitting in staging buffer, at least one
+
+template<typename T>
+constexpr size_t stage_len() { return stage_size() < sizeof(T) ? 1 : stage_size() / sizeof(T); }
+
+//-----------------------------------------------------------------------------
+// apply f(p, k) to each contiguous segment of a range, starting at pointer
+// `p` with length `k`
+
+template<typename A, typename F>
+void segments(A& a, F f)
+{
+	for(auto i = std::begin(a), e = std::end(a); i != e;)
+	{
+		auto p = &*i;
+		size_t k = 0;
+		for(; i != e && &*i == p + k; ++i, ++k);
+		f(p, k);
+	}
+}
+
 //-----------------------------------------------------------------------------
 // default dimensions for arbitrary 1-dimensional range, represented as
 // 64-bit unsigned integer
@@ -79,15 +151,37 @@ size_t total(const A& a) { return size(a) ? prod(a) : 0; }
 template<typename A, only_if<!is_range<A>{}> = 0>
 size_t total(const A& a) { return a; }
 
+//-----------------------------------------------------------------------------
+// a contiguous range may provide function `resize_raw(a, n)`, found by
+// argument-dependent lookup, to resize without initializing its elements;
+// these are overwritten anyway when read by memory copy
+
+template<typename A> using _resize_raw = decltype(resize_raw(gen<A&>(), 0));
+template<typename A> using has_resize_raw = sfinae<_resize_raw, A>;
+
+//-----------------------------------------------------------------------------
+// reserve space for `n` elements before insertion, if supported, e.g. by
+// std::vector or std::unordered_map
+
+template<typename A, only_if<has_reserve<A>{}> = 0>
+void reserve(A& a, size_t n) { a.reserve(n); }
+
+template<typename A, only_if<!has_reserve<A>{}> = 0>
+void reserve(A&, size_t) {}
+
 //-----------------------------------------------------------------------------
 // resize() if contiguous range of trivial elements (read by memory copy),
-// clear() otherwise (read by insert())
+// preferably via resize_raw(); clear() and reserve() otherwise (read by
+// insert())
+
+template<typename A, only_if<is_cont_triv<A>{} && has_resize_raw<A>{}> = 0>
+void resize(A& a, size_t n) { resize_raw(a, n); }
 
-template<typename A, only_if<is_cont_triv<A>{}> = 0>
+template<typename A, only_if<is_cont_triv<A>{} && !has_resize_raw<A>{}> = 0>
 void resize(A& a, size_t n) { a.resize(n); }
 
 template<typename A, only_if<!is_cont_triv<A>{}> = 0>
-void resize(A& a, size_t) { a.clear(); }
+void resize(A& a, size_t n) { a.clear(); reserve(a, n); }
 
 //-----------------------------------------------------------------------------
 // fixed if cannot be resized, in one way or another
@@ -96,21 +190,23 @@ template<typename A> using _resize = decltype(resize(gen<A&>(), 0));
 template<typename A> using is_fixed = expr<!sfinae<_resize, A>{}>;
 
 //-----------------------------------------------------------------------------
-// two different syntaxes for insert: sequence and associate containers
+// two different syntaxes for insert: sequence and associate containers; the
+// latter insert with hint at the end, which takes constant time if elements
+// are sorted (e.g. as written from an ordered container) and is correct anyway
 
 template<typename A, typename I, only_if<is_seq<A>{}> = 0>
 void insert(A& a, I b, I e) { a.insert(a.end(), b, e); }
 
 template<typename A, typename I, only_if<!is_seq<A>{}> = 0>
-void insert(A& a, I b, I e) { a.insert(b, e); }
+void insert(A& a, I b, I e) { for(; b != e; ++b) a.insert(a.end(), *b); }
 
 //-----------------------------------------------------------------------------
-// only trivial and range types currently unsupported
+// only trivial, range and record types currently supported
 
 template<typename A>
 void support()
 {
-	static_assert(is_triv<A>(), "Object type unsupported for serialization. Consider extending xread()/xwrite().");
+	static_assert(is_triv<A>(), "Object type unsupported for serialization. Consider XIO_FIELDS or extending xread()/xwrite().");
 }
 
 //-----------------------------------------------------------------------------
@@ -1,5 +1,8 @@
 #include <iostream>
 #include <fstream>
+#include <memory>
+#include <algorithm>
+#include <functional>
 
 #ifndef XIO_IO
 #define XIO_IO
@@ -16,9 +19,27 @@ namespace xio_details {
 // forward declarations
 
 template<typename S, typename A> void read(S& s, A& a);
-template<typename S, typename A> void write(S& s, A& a);
+template<typename S, typename A> void write(S& s, const A& a);
 template<typename S, typename A> void xread(S& s, A& a);
-template<typename S, typename A> void xwrite(S& s, A& a);
+template<typename S, typename A> void xwrite(S& s, const A& a);
+
+template<typename S> class swap_istream;
+template<typename S> class swap_ostream;
+template<typename S> class pack_istream;
+template<typename S> class pack_ostream;
+template<typename S> class check_istream;
+template<typename S> class check_ostream;
+
+// records are defined in record.hpp
+template<typename A, typename = void> struct is_record_t;
+template<typename A, typename = void> struct is_flat_t;
+template<typename A> using is_record = expr<is_record_t<A>{}>;
+template<typename A> using is_flat = expr<is_flat_t<A>{}>;
+
+template<typename X, typename S, typename A> void r_record(X x, S& s, A& a);
+template<typename X, typename S, typename A> void w_record(X x, S& s, const A& a);
+template<typename S, typename A> void r_flat(S& s, A& a, size_t n);
+template<typename S, typename A> void w_flat(S& s, const A& a);
 
 //-----------------------------------------------------------------------------
 // low-level serialization as direct memory copy, for trivially-copyable
@@ -30,12 +51,14 @@ std::streamsize io_size(size_t size) { return size * sizeof(T) / sizeof(C); }
 template<typename S, typename T, typename C = chr<S>>
 void r_mem(S& s, T* base, size_t size = 1)
 {
+	XIO_STATS_IO(size * sizeof(T));
 	s.read(reinterpret_cast<C*>(base), io_size<T, C>(size));
 }
 
 template<typename S, typename T, typename C = chr<S>>
 void w_mem(S& s, const T* base, size_t size = 1)
 {
+	XIO_STATS_IO(size * sizeof(T));
 	s.write(reinterpret_cast<const C*>(base), io_size<T, C>(size));
 }
 
@@ -44,52 +67,350 @@ void w_mem(S& s, const T* base, size_t size = 1)
 // this is the fastest method
 
 template<typename S, typename A, only_if<is_contig<A>{}> = 0>
-void r_elem_triv(S& s, A& a, size_t n) { r_mem(s, base(a), size(a)); }
+void r_elem_triv(S& s, A& a, size_t)
+{
+	XIO_STATS_PATH(contiguous);
+	r_mem(s, base(a), size(a));
+}
 
 template<typename S, typename A, only_if<is_contig<A>{}> = 0>
-void w_elem_triv(S& s, const A& a) { w_mem(s, base(a), size(a)); }
+void w_elem_triv(S& s, const A& a)
+{
+	XIO_STATS_PATH(contiguous);
+	w_mem(s, base(a), size(a));
+}
+
+//-----------------------------------------------------------------------------
+// serialization of segmented range trivial elements (e.g. std::deque) by
+// direct memory copy per segment, after resizing on reading
+
+template<typename S, typename A, only_if<is_segm<A>{}> = 0>
+void r_elem_triv(S& s, A& a, size_t n)
+{
+	XIO_STATS_PATH(segmented);
+	a.resize(n);
+	segments(a, [&](elem<A>* p, size_t k) { r_mem(s, p, k); });
+}
+
+template<typename S, typename A, only_if<is_segm<A>{}> = 0>
+void w_elem_triv(S& s, const A& a)
+{
+	XIO_STATS_PATH(segmented);
+	segments(a, [&](const elem<A>* p, size_t k) { w_mem(s, p, k); });
+}
+
+//-----------------------------------------------------------------------------
+// serialization of non-contiguous range trivial elements, staged in chunks
+// through a contiguous buffer of bounded size for acceleration, followed by
+// custom element insertion on reading
+
+template<typename S, typename A,
+	only_if<!is_contig<A>{} && !is_segm<A>{} && !is_bits<A>{}> = 0>
+void r_elem_triv(S& s, A& a, size_t n)
+{
+	XIO_STATS_PATH(staged);
+	using T = elem<A>;
+	size_t m = std::min(n, stage_len<T>());
+	std::unique_ptr<T[]> b(new T[m]);
+	for(size_t k; n; n -= k)
+	{
+		k = std::min(n, m);
+		r_mem(s, b.get(), k); insert(a, b.get(), b.get() + k);
+	}
+}
+
+template<typename S, typename A,
+	only_if<!is_contig<A>{} && !is_segm<A>{} && !is_bits<A>{}> = 0>
+void w_elem_triv(S& s, const A& a)
+{
+	XIO_STATS_PATH(staged);
+	using T = elem<A>;
+	size_t m = std::min(size(a), stage_len<T>());
+	std::unique_ptr<T[]> b(new T[m]);
+	for(auto i = std::begin(a), e = std::end(a); i != e;)
+	{
+		size_t k = 0;
+		for(; i != e && k < m; ++i) b[k++] = *i;
+		w_mem(s, b.get(), k);
+	}
+}
 
 //-----------------------------------------------------------------------------
-// serialization of non-contiguous range trivial elements using a contiguous
-// buffer for acceleration followed by custom element insertion
+// serialization of bits, packed 8 per byte, least significant first, staged
+// in chunks through a buffer of bounded size; the last byte is padded with
+// zeros
+
+template<typename S, typename I>
+void r_bits(S& s, I i, size_t n)
+{
+	raw_vector<uint8_t> b(std::min((n + 7) / 8, stage_size()));
+	for(size_t k; n; n -= k)
+	{
+		k = std::min(n, 8 * b.size());
+		r_mem(s, b.data(), (k + 7) / 8);
+		for(size_t j = 0; j < k; ++j, ++i) *i = b[j / 8] >> j % 8 & 1;
+	}
+}
+
+template<typename S, typename I>
+void w_bits(S& s, I i, size_t n)
+{
+	raw_vector<uint8_t> b(std::min((n + 7) / 8, stage_size()));
+	for(size_t k; n; n -= k)
+	{
+		k = std::min(n, 8 * b.size());
+		std::fill(b.begin(), b.begin() + (k + 7) / 8, 0);
+		for(size_t j = 0; j < k; ++j, ++i) b[j / 8] |= uint8_t(bool(*i) << j % 8);
+		w_mem(s, b.data(), (k + 7) / 8);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// the same, by direct memory copy of `n` bits at `p`, where bits are stored
+// as above; the last byte is masked
+
+template<typename S>
+void r_bits(S& s, char* p, size_t n)
+{
+	r_mem(s, p, (n + 7) / 8);
+	if(n % 8) p[n / 8] &= char((1 << n % 8) - 1);
+}
+
+template<typename S>
+void w_bits(S& s, const char* p, size_t n)
+{
+	w_mem(s, p, n / 8);
+	if(n % 8) { char c = p[n / 8] & char((1 << n % 8) - 1); w_mem(s, &c); }
+}
+
+//-----------------------------------------------------------------------------
+// iterator over bits of a bit set by index
+
+template<typename A>
+struct bit_iter
+{
+	A& a;
+	size_t i;
+
+	bit_iter& operator*() { return *this; }
+	bit_iter& operator++() { ++i; return *this; }
+	operator bool() const { return a[i]; }
+	bit_iter& operator=(bool b) { a.set(i, b); return *this; }
+};
+
+//-----------------------------------------------------------------------------
+// serialization of bit ranges and bit sets; libstdc++ stores these as words
+// of bits, least significant first, which is exactly the serialized layout
+// on little-endian machines
+
+template<typename S, typename A>
+void r_bitvec(S& s, A& a, size_t n) { r_bits(s, std::begin(a), n); }
+
+template<typename S, typename A>
+void w_bitvec(S& s, const A& a) { w_bits(s, std::begin(a), size(a)); }
+
+#ifdef __GLIBCXX__
+
+template<typename S, typename A>
+void r_bitvec(S& s, std::vector<bool, A>& a, size_t n)
+{
+	if(!little()) r_bits(s, a.begin(), n);
+	else r_bits(s, reinterpret_cast<char*>(a.begin()._M_p), n);
+}
+
+template<typename S, typename A>
+void w_bitvec(S& s, const std::vector<bool, A>& a)
+{
+	if(!little()) w_bits(s, a.begin(), a.size());
+	else w_bits(s, reinterpret_cast<const char*>(a.begin()._M_p), a.size());
+}
+
+#endif
 
-template<typename S, typename A, only_if<!is_contig<A>{}> = 0>
+template<typename S, typename A, only_if<is_bits<A>{}> = 0>
 void r_elem_triv(S& s, A& a, size_t n)
 {
-	std::vector<elem<A>> b(n);
-	read(s, b); insert(a, b.begin(), b.end());
+	XIO_STATS_PATH(bits);
+	a.resize(n); r_bitvec(s, a, n);
 }
 
-template<typename S, typename A, only_if<!is_contig<A>{}> = 0>
+template<typename S, typename A, only_if<is_bits<A>{}> = 0>
 void w_elem_triv(S& s, const A& a)
 {
-	std::vector<elem<A>> b(size(a));
-	std::copy(a.begin(), a.end(), b.begin()); write(s, b);
+	XIO_STATS_PATH(bits);
+	w_bitvec(s, a);
 }
 
+template<typename S, typename A>
+void r_bitset(S& s, A& a) { a.reset(); r_bits(s, bit_iter<A>{a, 0}, a.size()); }
+
+template<typename S, typename A>
+void w_bitset(S& s, const A& a) { w_bits(s, bit_iter<const A>{a, 0}, a.size()); }
+
+#ifdef __GLIBCXX__
+
+template<typename S, size_t N>
+void r_bitset(S& s, std::bitset<N>& a)
+{
+	a.reset();
+	if(!little() || !N) r_bits(s, bit_iter<std::bitset<N>>{a, 0}, N);
+	else r_bits(s, reinterpret_cast<char*>(&a), N);
+}
+
+template<typename S, size_t N>
+void w_bitset(S& s, const std::bitset<N>& a)
+{
+	if(!little() || !N) w_bits(s, bit_iter<const std::bitset<N>>{a, 0}, N);
+	else w_bits(s, reinterpret_cast<const char*>(&a), N);
+}
+
+#endif
+
 //-----------------------------------------------------------------------------
 // serialization of range non-trivial elements using custom instertion on
 // stream iterators; this is the most generic and slowest method
 
-template<typename S, typename A, only_if<is_triv<elem<A>>{}> = 0>
+template<typename S, typename A, only_if<is_triv<elem<A>>{} && !is_map<A>{}> = 0>
 void r_elem(S& s, A& a, size_t n) { r_elem_triv(s, a, n); }
 
-template<typename S, typename A, only_if<is_triv<elem<A>>{}> = 0>
+template<typename S, typename A, only_if<is_triv<elem<A>>{} && !is_map<A>{}> = 0>
 void w_elem(S& s, A& a) { w_elem_triv(s, a); }
 
-template<typename S, typename A, only_if<!is_triv<elem<A>>{}> = 0>
-void r_elem(S& s, A& a, size_t)
+template<typename S, typename A,
+	only_if<!is_triv<elem<A>>{} && !is_flat<elem<A>>{} && !is_map<A>{}> = 0>
+void r_elem(S& s, A& a, size_t n)
 {
+	XIO_STATS_PATH(iterator);
 	using T = elem<A>;
-	insert(a, begin<T>(s), end<T>(s));
+	insert(a, begin<T>(s, n), end<T>(s));
 }
 
-template<typename S, typename A, only_if<!is_triv<elem<A>>{}> = 0>
+template<typename S, typename A,
+	only_if<!is_triv<elem<A>>{} && !is_flat<elem<A>>{} && !is_map<A>{}> = 0>
 void w_elem(S& s, A& a)
 {
+	XIO_STATS_PATH(iterator);
 	std::copy(a.begin(), a.end(), begin<elem<A>>(s));
 }
 
+//-----------------------------------------------------------------------------
+// serialization of range of flat records (see record.hpp), packed in chunks
+
+template<typename S, typename A, only_if<is_flat<elem<A>>{} && !is_map<A>{}> = 0>
+void r_elem(S& s, A& a, size_t n) { r_flat(s, a, n); }
+
+template<typename S, typename A, only_if<is_flat<elem<A>>{} && !is_map<A>{}> = 0>
+void w_elem(S& s, A& a) { w_flat(s, a); }
+
+//-----------------------------------------------------------------------------
+// serialization of `n` elements at `p`, by memory copy if trivial
+
+template<typename S, typename T, only_if<is_triv<T>{}> = 0>
+void r_array(S& s, T* p, size_t n) { r_mem(s, p, n); }
+
+template<typename S, typename T, only_if<!is_triv<T>{}> = 0>
+void r_array(S& s, T* p, size_t n) { for(size_t i = 0; i < n; ++i) xread(s, p[i]); }
+
+//-----------------------------------------------------------------------------
+// serialization of member M (e.g. key or value) of `n` elements from
+// iterator `i`, staged through buffer `b` made by stage<T>(n) if trivial;
+// returns iterator past the last element
+
+struct key_of
+{
+	template<typename P>
+	const typename P::first_type& operator()(const P& p) const { return p.first; }
+};
+
+struct val_of
+{
+	template<typename P>
+	const typename P::second_type& operator()(const P& p) const { return p.second; }
+};
+
+template<typename A, typename M>
+using member = typename std::decay<decltype(M()(gen<elem<A>>()))>::type;
+
+template<typename T, only_if<is_triv<T>{}> = 0>
+std::unique_ptr<T[]> stage(size_t n)
+{
+	return std::unique_ptr<T[]>(new T[std::min(n, stage_len<T>())]);
+}
+
+template<typename T, only_if<!is_triv<T>{}> = 0>
+std::unique_ptr<T[]> stage(size_t) { return nullptr; }
+
+template<typename M, typename S, typename I, typename T, only_if<is_triv<T>{}> = 0>
+I w_member(S& s, I i, size_t n, T* b)
+{
+	for(size_t k; n; n -= k)
+	{
+		k = std::min(n, stage_len<T>());
+		for(size_t j = 0; j < k; ++i, ++j) b[j] = M()(*i);
+		w_mem(s, b, k);
+	}
+	return i;
+}
+
+template<typename M, typename S, typename I, typename T, only_if<!is_triv<T>{}> = 0>
+I w_member(S& s, I i, size_t n, T*)
+{
+	for(; n; ++i, --n) xwrite(s, M()(*i));
+	return i;
+}
+
+// member M of all elements of range `a`
+template<typename M, typename S, typename A>
+void w_member(S& s, const A& a)
+{
+	auto b = stage<member<A, M>>(size(a));
+	w_member<M>(s, std::begin(a), size(a), b.get());
+}
+
+//-----------------------------------------------------------------------------
+// serialization of associative range of (key, value) pairs in columns per
+// chunk of map_chunk() pairs: the keys of the chunk followed by its values,
+// such that trivial keys or values are copied in bulk, and memory is bounded
+// on both writing and reading. On reading, pairs are inserted with hint at
+// the end.
+
+constexpr size_t map_chunk() { return 1 << 12; }
+
+template<typename S, typename A, only_if<is_map<A>{}> = 0>
+void r_elem(S& s, A& a, size_t n)
+{
+	XIO_STATS_PATH(map);
+	using K = typename std::remove_const<typename elem<A>::first_type>::type;
+	using V = typename elem<A>::second_type;
+	size_t c = std::min(n, map_chunk());
+	std::unique_ptr<K[]> k(new K[c]);
+	std::unique_ptr<V[]> v(new V[c]);
+	for(size_t i = 0, m; i < n && s; i += m)
+	{
+		m = std::min(n - i, c);
+		r_array(s, k.get(), m);
+		r_array(s, v.get(), m);
+		for(size_t j = 0; j < m; ++j)
+			a.emplace_hint(a.end(), std::move(k[j]), std::move(v[j]));
+	}
+}
+
+template<typename S, typename A, only_if<is_map<A>{}> = 0>
+void w_elem(S& s, A& a)
+{
+	XIO_STATS_PATH(map);
+	size_t n = size(a), c = std::min(n, map_chunk());
+	auto k = stage<member<A, key_of>>(c);
+	auto v = stage<member<A, val_of>>(c);
+	auto i = std::begin(a);
+	for(size_t j = 0, m; j < n; j += m)
+	{
+		m = std::min(n - j, c);
+		w_member<key_of>(s, i, m, k.get());
+		i = w_member<val_of>(s, i, m, v.get());
+	}
+}
+
 //-----------------------------------------------------------------------------
 // serialization of dimensions; assumes function call `dims(a)` yields
 // another range `d` holding the dimensions of the given range `a`;
@@ -127,19 +448,34 @@ template<typename X, typename S, typename A, only_if<!is_range<A>{}> = 0>
 void w_rng(X, S& s, const A& a) { support<A>(); }
 
 //-----------------------------------------------------------------------------
-// classification into trivial/non-trival type
+// classification into trivial/non-trival type, bit set (fixed-size), or
+// record of fields (see record.hpp)
 
-template<typename X, typename S, typename A, only_if<!is_triv<A>{}> = 0>
+template<typename X, typename S, typename A,
+	only_if<!is_triv<A>{} && !is_bitset<A>{} && !is_record<A>{}> = 0>
 void r_main(X x, S& s, A& a) { r_rng(x, s, a); }
 
-template<typename X, typename S, typename A, only_if<!is_triv<A>{}> = 0>
+template<typename X, typename S, typename A,
+	only_if<!is_triv<A>{} && !is_bitset<A>{} && !is_record<A>{}> = 0>
 void w_main(X x, S& s, const A& a) { w_rng(x, s, a); }
 
+template<typename X, typename S, typename A, only_if<is_record<A>{}> = 0>
+void r_main(X x, S& s, A& a) { r_record(x, s, a); }
+
+template<typename X, typename S, typename A, only_if<is_record<A>{}> = 0>
+void w_main(X x, S& s, const A& a) { w_record(x, s, a); }
+
+template<typename X, typename S, typename A, only_if<is_bitset<A>{}> = 0>
+void r_main(X, S& s, A& a) { XIO_STATS_PATH(bits); r_bitset(s, a); }
+
+template<typename X, typename S, typename A, only_if<is_bitset<A>{}> = 0>
+void w_main(X, S& s, const A& a) { XIO_STATS_PATH(bits); w_bitset(s, a); }
+
 template<typename X, typename S, typename A, only_if<is_triv<A>{}> = 0>
-void r_main(X, S& s, A& a) { r_mem(s, &a); }
+void r_main(X, S& s, A& a) { XIO_STATS_PATH(trivial); r_mem(s, &a); }
 
 template<typename X, typename S, typename A, only_if<is_triv<A>{}> = 0>
-void w_main(X, S& s, const A& a) { w_mem(s, &a); }
+void w_main(X, S& s, const A& a) { XIO_STATS_PATH(trivial); w_mem(s, &a); }
 
 //-----------------------------------------------------------------------------
 // classification into extended/non-extended serialization
@@ -148,13 +484,13 @@ template<typename S, typename A>
 void read(S& s, A& a) { r_main(_false(), s, a); }
 
 template<typename S, typename A>
-void write(S& s, A& a) { w_main(_false(), s, a); }
+void write(S& s, const A& a) { w_main(_false(), s, a); }
 
 template<typename S, typename A>
 void xread(S& s, A& a) { r_main(_true(), s, a); }
 
 template<typename S, typename A>
-void xwrite(S& s, A& a) { w_main(_true(), s, a); }
+void xwrite(S& s, const A& a) { w_main(_true(), s, a); }
 
 //-----------------------------------------------------------------------------
 // multi-argument generalizations for any data type
@@ -193,39 +529,230 @@ struct xwriter
 // a pointer + size, a built-in array or any contiguous range of the
 // character type of the stream
 
+template<typename S, typename F>
+void xopen(S& s, const F& f)
+{
+	s.open(f, std::ios_base::binary);
+	if(!s) throw e_open(f);
+}
+
 template<typename S, typename F, typename T>
 void xopen(S& s, const F& f, chr<S>* u, T n)
 {
 	if(u) setbuf(s, u, n);
-	s.open(f, std::ios_base::binary);
-	if(!s) throw e_open(f);
+	xopen(s, f);
 }
 
 template<typename S, typename F, typename B>
 void xopen(S& s, const F& f, B& b) { xopen(s, f, base(b), size(b)); }
 
+//-----------------------------------------------------------------------------
+// stream counting written bytes without storing them, for dry runs
+
+struct counter
+{
+	using char_type = char;
+	size_t n;
+
+	counter() : n(0) {}
+	void write(const char_type*, std::streamsize k) { n += k; }
+};
+
+// no bytes are actually written
+template<typename T>
+void w_mem(counter& s, const T*, size_t size = 1) { s.n += size * sizeof(T); }
+
+//-----------------------------------------------------------------------------
+// size of serialized dimensions, i.e. offset of elements in the serialization
+// of a range; zero for non-ranges
+
+template<typename A, only_if<is_range<A>{}> = 0>
+size_t dims_size(const A& a) { counter c; w_dims(_true(), c, a); return c.n; }
+
+template<typename A, only_if<!is_range<A>{}> = 0>
+size_t dims_size(const A&) { return 0; }
+
+//-----------------------------------------------------------------------------
+// file header: if present on reading, the stream is positioned at the first
+// object; otherwise it is left at its initial position. On writing, padding
+// is inserted such that the elements of object `a` are aligned as requested,
+// unless compressed
+
 template<typename S, typename F>
-void xopen(S& s, const F& f) { xopen(s, f, nullptr, buffer_size()); }
+bool r_head(S& s, header& h, const F& f)
+{
+	auto p = s.tellg();
+	r_mem(s, h.sig, sizeof(h.sig));
+	if(!s || !h.valid()) { s.clear(); s.seekg(p); return false; }
+	read(s, h.bom, h.version, h.offset, h.align, h.pack);
+	if(h.swapped()) h.version = bswap(h.version);
+	if(h.version >= 2) read(s, h.type);
+	if(h.version >= 3) read(s, h.check);
+	if(h.swapped())
+		for(uint64_t* x : {&h.offset, &h.align, &h.pack, &h.type, &h.check}) *x = bswap(*x);
+	if(!s || (h.swapped() && h.bom != bswap(mark())) ||
+		h.version > version() || h.offset < head_size(h.version) ||
+		h.pack > uint64_t(codec::packed) || h.type > uint64_t(scalar::f8) ||
+		h.check > uint64_t(1) << 32)
+		throw e_format(f);
+	s.seekg(p + std::streamoff(h.offset)); return true;
+}
+
+// given size `d` of serialized dimensions of the first object and scalar
+// type `t` of its elements
+template<typename S>
+void w_head_dims(S& s, const format& x, size_t d, scalar t = scalar::none)
+{
+	header h(x);
+	h.type = uint64_t(t);
+	h.offset = h.packed() ? sizeof(header) : round_up(sizeof(header) + d, h.align) - d;
+	std::vector<char> pad(h.offset - sizeof(header));
+	if(swapped(x.order))
+		for(uint64_t* y : {&h.bom, &h.version, &h.offset, &h.align, &h.pack, &h.type, &h.check})
+			*y = bswap(*y);
+	w_mem(s, h.sig, sizeof(h.sig));
+	write(s, h.bom, h.version, h.offset, h.align, h.pack, h.type, h.check);
+	w_mem(s, pad.data(), pad.size());
+}
+
+// scalar type of object, or of elements of range
+template<typename A, only_if<is_range<A>{}> = 0>
+constexpr scalar head_type() { return scalar_of<elem<A>>(); }
+
+template<typename A, only_if<!is_range<A>{}> = 0>
+constexpr scalar head_type() { return scalar_of<A>(); }
+
+// check scalar type recorded in header `h` of file `f`, if any, against that
+// of object of type A, if a scalar type; loading into another type throws
+template<typename A, typename F>
+void r_head_type(const header& h, const F& f)
+{
+	scalar t = head_type<typename std::decay<A>::type>();
+	if(h.type && t != scalar::none && h.type != uint64_t(t)) throw e_format(f);
+}
+
+template<typename S, typename A>
+void w_head(S& s, const format& x, const A& a)
+{
+	w_head_dims(s, x, x.pack == codec::none ? dims_size(a) : 0, head_type<A>());
+}
 
 //-----------------------------------------------------------------------------
-// file operations, creating file streams from file names
+// call function object `g` on stream `s` to read or write objects following
+// file header, wrapping `s` by adaptors for checksums, decompression and
+// byte order conversion as needed; there is no overhead for native,
+// uncompressed files without checksums. On reading, return false if any
+// read failed, e.g. on a truncated file.
+
+template<typename S, typename G>
+bool r_swap(S& s, const header& h, G g)
+{
+	if(!h.swapped()) { g(s); return bool(s); }
+	swap_istream<S> t(s); g(t); return bool(t);
+}
 
-template<typename F, typename A, typename... B>
+template<typename S, typename G>
+void w_swap(S& s, const format& x, G g)
+{
+	if(!swapped(x.order)) g(s);
+	else { swap_ostream<S> t(s); g(t); }
+}
+
+template<typename S, typename G>
+bool r_pack(S& s, const header& h, G g)
+{
+	if(!h.packed()) return r_swap(s, h, g);
+	pack_istream<S> t(s); return r_swap(t, h, g);
+}
+
+template<typename S, typename G>
+void w_pack(S& s, const format& x, G g)
+{
+	if(x.pack == codec::none) w_swap(s, x, g);
+	else { pack_ostream<S> t(s); w_swap(t, x, g); t.close(); }
+}
+
+template<typename S, typename G>
+bool r_with(S& s, const header& h, G g)
+{
+	if(!h.check) return r_pack(s, h, g);
+	check_istream<S> t(s, h); bool r = r_pack(t, h, g); return t.finish() && r;
+}
+
+template<typename S, typename G>
+void w_with(S& s, const format& x, G g)
+{
+	if(x.check == checksum::none) w_pack(s, x, g);
+	else { check_ostream<S> t(s, x); w_pack(t, x, g); t.close(); }
+}
+
+//-----------------------------------------------------------------------------
+// objects following file header, or entire file
+
+template<typename S, typename A, typename... B>
+bool r_body(S& s, const header& h, A& a, B&... b)
+{
+	using std::placeholders::_1;
+	return r_with(s, h, std::bind(xreader(), _1, std::ref(a), std::ref(b)...));
+}
+
+template<typename S, typename A, typename... B>
+void w_file(S& s, const format& x, const A& a, const B&... b)
+{
+	using std::placeholders::_1;
+	w_head(s, x, a);
+	w_with(s, x, std::bind(xwriter(), _1, std::cref(a), std::cref(b)...));
+}
+
+template<typename S, typename F, typename A, typename... B>
+bool r_file(S& s, const F& f, A& a, B&... b)
+{
+	header h;
+	r_head(s, h, f); r_head_type<A>(h, f);
+	return r_body(s, h, a, b...);
+}
+
+//-----------------------------------------------------------------------------
+// file operations, creating file streams from file names; a header is
+// written only if a format is given, and is read on loading if present.
+// Loading fails if the file ends before all objects are read.
+
+// options given before file names, e.g. format; never file names themselves,
+// so non-const file names do not select the generic operations below
+template<typename F>
+struct is_option : _false {};
+
+template<>
+struct is_option<format> : _true {};
+
+template<typename F, typename A, typename... B, only_if<!is_option<F>{}> = 0>
 void xload(const F& f, A& a, B&... b)
 {
-	std::ifstream s;
+	XIO_STATS_CALL("load");
 	std::vector<char> u(buffer_size());
-	xopen(s, f, u); xread(s, a, b...);
+	std::ifstream s;
+	xopen(s, f, u);
+	if(!r_file(s, f, a, b...)) throw e_read(f);
 }
 
-template<typename F, typename A, typename... B>
+template<typename F, typename A, typename... B, only_if<!is_option<F>{}> = 0>
 void xsave(const F& f, const A& a, const B&... b)
 {
-	std::ofstream s;
+	XIO_STATS_CALL("save");
 	std::vector<char> u(buffer_size());
+	std::ofstream s;
 	xopen(s, f, u); xwrite(s, a, b...);
 }
 
+template<typename F, typename A, typename... B>
+void xsave(const format& x, const F& f, const A& a, const B&... b)
+{
+	XIO_STATS_CALL("save");
+	std::vector<char> u(buffer_size());
+	std::ofstream s;
+	xopen(s, f, u); w_file(s, x, a, b...);
+}
+
 //-----------------------------------------------------------------------------
 // convenience one-argument read/load operations; type A is required on call
 // xread may be inefficient on large types, requiring additional copy
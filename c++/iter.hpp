@@ -1,3 +1,4 @@
+#include <exception>
 #include <iterator>
 #include <cstddef>
 
@@ -13,8 +14,17 @@ namespace xio {
 namespace xio_details {
 
 //-----------------------------------------------------------------------------
+// stream iterator exception
 
-inline void check(bool) {}  // TODO: exception
+struct e_iter : std::exception
+{
+	const char* what() const noexcept override
+	{
+		return "stream iterator used past end of stream\n";
+	}
+};
+
+inline void check(bool b) { if(!b) throw e_iter(); }
 
 //-----------------------------------------------------------------------------
 // forward declarations
@@ -32,18 +42,19 @@ class istream_iter :
 	using I = istream_iter;
 	S* stream;
 	T elem;
+	size_t left;
 	bool ok;
 
 	void read()
 	{
-		ok = stream && *stream;
-		if(ok) { F()(*stream, elem); ok = *stream; }
+		ok = stream && left && bool(*stream);
+		if(ok) { --left; F()(*stream, elem); ok = bool(*stream); }
 	}
 
 public:
-	constexpr istream_iter() : stream(nullptr), elem(), ok(false) {}
-	istream_iter(S& s)       : stream(&s), elem() { read(); }
-	istream_iter(const I& i) : stream(i.stream), elem(i.elem), ok(i.ok) {}
+	constexpr istream_iter() : stream(nullptr), elem(), left(0), ok(false) {}
+	istream_iter(S& s, size_t n = size_t(-1)) : stream(&s), elem(), left(n) { read(); }
+	istream_iter(const I& i) : stream(i.stream), elem(i.elem), left(i.left), ok(i.ok) {}
 
 	const T& operator*() const { check(ok); return elem; }
 	const T* operator->() const { return &(operator*()); }
@@ -92,23 +103,19 @@ class ostream_iter :
 };
 
 //-----------------------------------------------------------------------------
-// begin()/end() constructors
-
-template<typename T, typename F = xwriter>
-istream_iter<std::istream, T, F>
-begin(std::istream& s, T& e) { return istream_iter<std::istream, T, F>(s, e); }
+// begin()/end() constructors; input iterators read up to `n` elements
 
-template<typename T, typename F = xwriter>
-istream_iter<std::istream, T, F>
-end(std::istream&) { return istream_iter<std::istream, T, F>(); }
+template<typename T, typename F = xreader, typename S>
+istream_iter<S, T, F>
+begin(S& s, size_t n) { return istream_iter<S, T, F>(s, n); }
 
-template<typename T, typename F = xwriter>
-ostream_iter<std::ostream, T, F>
-begin(std::ostream& s) { return ostream_iter<std::ostream, T, F>(s); }
+template<typename T, typename F = xreader, typename S>
+istream_iter<S, T, F>
+end(S&) { return istream_iter<S, T, F>(); }
 
-template<typename T, typename F = xwriter>
-ostream_iter<std::ostream, T, F>
-end(std::ostream&) { return ostream_iter<std::ostream, T, F>(); }
+template<typename T, typename F = xwriter, typename S>
+ostream_iter<S, T, F>
+begin(S& s) { return ostream_iter<S, T, F>(s); }
 
 //-----------------------------------------------------------------------------
 
@@ -0,0 +1,385 @@
+#include <exception>
+#include <fcntl.h>
+#include <unistd.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#ifdef IO_URING_OP_SUPPORTED  // headers of Linux 5.6 or later
+#define XIO_URING
+#include <initializer_list>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+#endif
+#endif
+
+#ifndef XIO_MANY
+#define XIO_MANY
+
+//-----------------------------------------------------------------------------
+
+namespace xio {
+
+//-----------------------------------------------------------------------------
+
+namespace xio_details {
+
+//-----------------------------------------------------------------------------
+// batch loading exception
+
+struct e_many : std::exception
+{
+	const char* what() const noexcept override
+	{
+		return "numbers of files and objects differ\n";
+	}
+};
+
+//-----------------------------------------------------------------------------
+// maximum number of files in flight, and size of first read of each file,
+// holding header and dimensions, and possibly the entire file
+
+constexpr size_t many_depth() { return 64; }
+constexpr size_t many_head() { return 1 << 12; }
+
+//-----------------------------------------------------------------------------
+// load each object `t[i]` from file `n[i]` by separate file operations, by
+// at most x.threads concurrently; rethrow first exception by file order
+
+template<typename A>
+void m_pool(const par& x, const std::vector<std::string>& n, const std::vector<A*>& t,
+	const std::vector<size_t>& which)
+{
+	std::vector<std::exception_ptr> err(which.size());
+	std::atomic<size_t> next(0);
+	size_t k = std::max(size_t(1), std::min(x.threads, which.size()));
+	executor e = x.exec ? x.exec : executor(spawn);
+	XIO_STATS_FORK();
+	e(k, [&](size_t)
+	{
+		XIO_STATS_JOIN();
+		for(size_t j; (j = next++) < which.size();)
+		{
+			try { xload(posix(1 << 16), n[which[j]], *t[which[j]]); }
+			catch(...) { err[j] = std::current_exception(); }
+		}
+	});
+	for(auto& p : err) if(p) std::rethrow_exception(p);
+}
+
+#ifdef XIO_URING
+
+//-----------------------------------------------------------------------------
+// minimal io_uring instance by system calls: submission and completion
+// rings mapped from the kernel; invalid if unavailable, e.g. on older
+// kernels or when forbidden
+
+class uring
+{
+	int fd;
+	unsigned *sq_tail, *sq_mask, *sq_array, *cq_head, *cq_tail, *cq_mask;
+	io_uring_sqe* sqes;
+	io_uring_cqe* cqes;
+	void* sq;
+	void* cq;
+	size_t sq_len, cq_len, sqe_len;
+	unsigned queued;
+
+	static void* map(int fd, size_t n, off_t o)
+	{
+		void* p = ::mmap(nullptr, n, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, o);
+		return p == MAP_FAILED ? nullptr : p;
+	}
+
+	template<typename T>
+	static T* at(void* p, unsigned o) { return reinterpret_cast<T*>(static_cast<char*>(p) + o); }
+
+public:
+	uring(unsigned n) : sqes(nullptr), sq(nullptr), cq(nullptr), queued(0)
+	{
+		io_uring_params p;
+		std::memset(&p, 0, sizeof(p));
+		fd = ::syscall(__NR_io_uring_setup, n, &p);
+		if(fd < 0) return;
+
+		sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+		cq_len = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+		sqe_len = p.sq_entries * sizeof(io_uring_sqe);
+		if(p.features & IORING_FEAT_SINGLE_MMAP) sq_len = cq_len = std::max(sq_len, cq_len);
+
+		sq = map(fd, sq_len, IORING_OFF_SQ_RING);
+		cq = p.features & IORING_FEAT_SINGLE_MMAP ? sq : map(fd, cq_len, IORING_OFF_CQ_RING);
+		sqes = static_cast<io_uring_sqe*>(map(fd, sqe_len, IORING_OFF_SQES));
+		if(!sq || !cq || !sqes) { release(); return; }
+
+		sq_tail = at<unsigned>(sq, p.sq_off.tail);
+		sq_mask = at<unsigned>(sq, p.sq_off.ring_mask);
+		sq_array = at<unsigned>(sq, p.sq_off.array);
+		cq_head = at<unsigned>(cq, p.cq_off.head);
+		cq_tail = at<unsigned>(cq, p.cq_off.tail);
+		cq_mask = at<unsigned>(cq, p.cq_off.ring_mask);
+		cqes = at<io_uring_cqe>(cq, p.cq_off.cqes);
+	}
+
+	uring(const uring&) = delete;
+
+	~uring() { release(); }
+
+	void release()
+	{
+		if(sqes) ::munmap(sqes, sqe_len);
+		if(cq && cq != sq) ::munmap(cq, cq_len);
+		if(sq) ::munmap(sq, sq_len);
+		if(fd >= 0) ::close(fd);
+		sq = cq = nullptr; sqes = nullptr; fd = -1;
+	}
+
+	explicit operator bool() const { return fd >= 0; }
+
+	// true if all operations `ops` are supported, as probed from the kernel;
+	// false if probing fails, as before Linux 5.6, where setup may succeed
+	// but operations like IORING_OP_OPENAT or IORING_OP_READ are missing
+	bool supports(std::initializer_list<unsigned> ops) const
+	{
+		constexpr unsigned k = 256;
+		std::vector<char> b(sizeof(io_uring_probe) + k * sizeof(io_uring_probe_op));
+		io_uring_probe* p = reinterpret_cast<io_uring_probe*>(b.data());
+		if(::syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, p, k) < 0) return false;
+		for(unsigned o : ops)
+			if(o > p->last_op || !(p->ops[o].flags & IO_URING_OP_SUPPORTED)) return false;
+		return true;
+	}
+
+	// queue operation with given user data; at most as many as ring entries
+	// between submissions
+	io_uring_sqe& push(uint64_t data)
+	{
+		unsigned t = *sq_tail + queued++, i = t & *sq_mask;
+		io_uring_sqe& e = sqes[i];
+		std::memset(&e, 0, sizeof(e));
+		e.user_data = data;
+		sq_array[i] = i;
+		return e;
+	}
+
+	// submit queued operations and wait for at least one completion
+	bool submit()
+	{
+		__atomic_store_n(sq_tail, *sq_tail + queued, __ATOMIC_RELEASE);
+		unsigned k = queued;
+		queued = 0;
+		for(;;)
+		{
+			long r = ::syscall(__NR_io_uring_enter, fd, k, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+			if(r >= 0) return true;
+			if(errno != EINTR) return false;
+			k = 0;
+		}
+	}
+
+	// call g(data, result) on each completion
+	template<typename G>
+	void reap(G g)
+	{
+		unsigned h = *cq_head, t = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+		for(; h != t; ++h)
+		{
+			io_uring_cqe& c = cqes[h & *cq_mask];
+			g(c.user_data, c.res);
+		}
+		__atomic_store_n(cq_head, h, __ATOMIC_RELEASE);
+	}
+};
+
+//-----------------------------------------------------------------------------
+// state of loading one file through io_uring: open, read head, then read
+// remaining elements directly to their destination; files not in native
+// uncompressed format, or whose dimensions exceed the head, are marked to
+// be loaded separately
+
+struct m_job
+{
+	enum { open, head, body, done } stage;
+	int fd;
+	raw_vector<char> buf;
+	char* dst;
+	size_t left;
+	off_t off;
+	bool slow;
+
+	m_job() : stage(open), fd(-1), dst(nullptr), left(0), off(0), slow(false) {}
+};
+
+// parse head of `k` bytes read from file `f` into object `a`; return false
+// if it should be loaded separately, e.g. to verify checksums
+template<typename A>
+bool m_parse(m_job& j, const std::string& f, A& a, size_t k)
+{
+	span_reader s(j.buf.data(), k);
+	header h;
+	r_head(s, h, f); r_head_type<A>(h, f);
+	if(h.swapped() || h.packed() || h.check) return false;
+
+	// dimensions are read into a copy first, in case they exceed the head
+	auto&& d = dims(a);
+	typename std::decay<decltype(d)>::type e = d;
+	xread(s, e);
+	if(!s) return false;
+	d = e;
+	size_t n = total(e);
+	resize(a, n);
+	n *= sizeof(elem<A>);
+
+	size_t o = s.tellg(), m = std::min(n, k - o);
+	char* p = reinterpret_cast<char*>(base(a));
+	if(m) std::memcpy(p, j.buf.data() + o, m);
+	j.dst = p + m; j.left = n - m; j.off = o + m;
+	if(j.left && k < j.buf.size()) throw e_read(f);
+	return true;
+}
+
+// advance job `i` on completion with result `r`, queueing next operation on
+// ring `q`; return true if another operation is queued
+template<typename A>
+bool m_step(uring& q, m_job& j, size_t i, const std::string& f, A& a, int r)
+{
+	if(r < 0 && j.stage == m_job::open) throw e_open(f);
+	if(r < 0) throw e_read(f);
+	switch(j.stage)
+	{
+		case m_job::open:
+			j.fd = r;
+			j.buf.resize(many_head());
+			j.stage = m_job::head;
+			{
+				io_uring_sqe& e = q.push(i);
+				e.opcode = IORING_OP_READ; e.fd = j.fd;
+				e.addr = uint64_t(j.buf.data()); e.len = j.buf.size(); e.off = 0;
+			}
+			return true;
+
+		case m_job::head:
+			XIO_STATS_IO(r);
+			j.slow = !m_parse(j, f, a, r);
+			j.buf = raw_vector<char>();
+			j.stage = m_job::body;
+			break;
+
+		case m_job::body:
+			if(r == 0) throw e_read(f);
+			XIO_STATS_IO(r);
+			j.dst += r; j.left -= r; j.off += r;
+			break;
+
+		case m_job::done:
+			return false;
+	}
+
+	if(j.slow || !j.left) { j.stage = m_job::done; return false; }
+	io_uring_sqe& e = q.push(i);
+	e.opcode = IORING_OP_READ; e.fd = j.fd;
+	e.addr = uint64_t(j.dst); e.len = unsigned(std::min(j.left, size_t(1) << 30)); e.off = j.off;
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// load through io_uring, keeping up to many_depth() files in flight; return
+// false if io_uring or any operation needed is unavailable
+
+template<typename A, only_if<is_bulk<A>{}> = 0>
+bool m_uring(const par& x, const std::vector<std::string>& n, const std::vector<A*>& t)
+{
+	uring q(many_depth());
+	if(!q || !q.supports({IORING_OP_OPENAT, IORING_OP_READ})) return false;
+
+	std::vector<m_job> job(n.size());
+	std::vector<std::exception_ptr> err(n.size());
+	std::vector<size_t> slow;
+	size_t next = 0, busy = 0;
+
+	while(next < n.size() || busy)
+	{
+		for(; next < n.size() && busy < many_depth(); ++next, ++busy)
+		{
+			io_uring_sqe& e = q.push(next);
+			e.opcode = IORING_OP_OPENAT; e.fd = AT_FDCWD;
+			e.addr = uint64_t(n[next].c_str()); e.open_flags = O_RDONLY | O_CLOEXEC;
+		}
+		if(!q.submit()) throw e_read(n[0]);
+		q.reap([&](uint64_t i, int r)
+		{
+			m_job& j = job[i];
+			bool more = false;
+			try { more = m_step(q, j, i, n[i], *t[i], r); }
+			catch(...) { err[i] = std::current_exception(); j.stage = m_job::done; }
+			if(more) return;
+			--busy;
+			if(j.fd >= 0) { ::close(j.fd); j.fd = -1; }
+		});
+	}
+
+	for(size_t i = 0; i < n.size(); ++i)
+	{
+		if(err[i]) std::rethrow_exception(err[i]);
+		if(job[i].slow) slow.push_back(i);
+	}
+	m_pool(x, n, t, slow);
+	return true;
+}
+
+#else
+
+template<typename A, only_if<is_bulk<A>{}> = 0>
+bool m_uring(const par&, const std::vector<std::string>&, const std::vector<A*>&) { return false; }
+
+#endif
+
+template<typename A, only_if<!is_bulk<A>{}> = 0>
+bool m_uring(const par&, const std::vector<std::string>&, const std::vector<A*>&) { return false; }
+
+//-----------------------------------------------------------------------------
+// load each object in range `t` from the corresponding file in range `n`,
+// with many files in flight. Contiguous ranges of trivial elements in files
+// of native byte order without compression are read by io_uring on Linux,
+// if available: files are opened and read as completions arrive, where the
+// first read of each file holds its header and dimensions, and possibly
+// all of its elements; any remaining elements are read directly to their
+// destination. Otherwise, files are loaded by a pool of x.threads threads.
+// Each file should hold one object.
+
+template<typename N, typename T>
+void xload_many(const par& x, const N& n, T& t)
+{
+	using A = elem<T>;
+	std::vector<std::string> f;
+	std::vector<A*> a;
+	for(auto& i : n) f.emplace_back(i);
+	for(auto& i : t) a.push_back(&i);
+	if(f.size() != a.size()) throw e_many();
+	XIO_STATS_CALL("load");
+
+	if(m_uring(x, f, a)) return;
+	std::vector<size_t> all(f.size());
+	for(size_t i = 0; i < all.size(); ++i) all[i] = i;
+	m_pool(x, f, a, all);
+}
+
+template<typename N, typename T>
+void xload_many(const N& n, T& t) { xload_many(par(), n, t); }
+
+//-----------------------------------------------------------------------------
+
+}  // namespace xio_details
+
+//-----------------------------------------------------------------------------
+
+using xio_details::xload_many;
+
+//-----------------------------------------------------------------------------
+
+}  // namespace xio
+
+//-----------------------------------------------------------------------------
+
+#endif // XIO_MANY
@@ -0,0 +1,120 @@
+#include <memory>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifndef XIO_MAP
+#define XIO_MAP
+
+//-----------------------------------------------------------------------------
+
+namespace xio {
+
+//-----------------------------------------------------------------------------
+
+namespace xio_details {
+
+//-----------------------------------------------------------------------------
+// read-only memory mapping of an entire file, shared with other processes
+// mapping the same file
+
+class mapping
+{
+	const char* addr;
+	size_t len;
+
+public:
+	template<typename F>
+	mapping(const F& f) : addr(nullptr), len(0)
+	{
+		int fd = ::open(c_str(f), O_RDONLY);
+		struct stat st;
+		if(fd < 0 || ::fstat(fd, &st)) { if(fd >= 0) ::close(fd); throw e_open(f); }
+		len = st.st_size;
+		void* p = len ? ::mmap(nullptr, len, PROT_READ, MAP_SHARED, fd, 0) : nullptr;
+		::close(fd);
+		if(p == MAP_FAILED) throw e_open(f);
+		addr = static_cast<const char*>(p);
+	}
+
+	~mapping() { if(addr) ::munmap(const_cast<char*>(addr), len); }
+
+	mapping(const mapping&) = delete;
+	mapping& operator=(const mapping&) = delete;
+
+	const char* data() const { return addr; }
+	size_t size() const { return len; }
+};
+
+//-----------------------------------------------------------------------------
+// read-only n-dimensional view of contiguous trivial elements of type T,
+// with dimensions of type D, aliasing a file mapping; copies share the
+// mapping, which is released with the last copy
+
+template<typename T, typename D = uint64_t>
+class map_view
+{
+	std::shared_ptr<const mapping> m;
+	const T* p;
+	D d;
+
+public:
+	map_view() : p(nullptr), d() {}
+
+	map_view(std::shared_ptr<const mapping> m, const T* p, const D& d) :
+		m(m), p(p), d(d) {}
+
+	const T* data() const { return p; }
+	const T* begin() const { return p; }
+	const T* end() const { return p + size(); }
+
+	size_t size() const { return total(d); }
+	const T& operator[](size_t i) const { return p[i]; }
+
+	friend const D& dims(const map_view& v) { return v.d; }
+};
+
+//-----------------------------------------------------------------------------
+// map a file holding a single array with elements of type T and dimensions
+// of type D, as saved by xsave(); the dimensions are read by xread() and the
+// elements are not copied. Use xsave() with a format specifying alignment for
+// aligned elements. Only uncompressed files of native byte order can be mapped;
+// checksums are not verified.
+
+template<typename T, typename D = uint64_t, typename F>
+map_view<T, D> xmap(const F& f)
+{
+	static_assert(is_triv<T>(), "Only trivially copyable elements can be mapped.");
+
+	std::ifstream s;
+	header h;
+	D d;
+	xopen(s, f); r_head(s, h, f); r_head_type<T>(h, f);
+	if(h.swapped() || h.packed()) throw e_format(f);
+	xread(s, d);
+	if(!s) throw e_format(f);
+
+	uint64_t o = s.tellg(), n = total(d);
+	auto m = std::make_shared<const mapping>(f);
+	if(o % alignof(T) || o > m->size() || n > (m->size() - o) / sizeof(T))
+		throw e_format(f);
+	return map_view<T, D>(m, reinterpret_cast<const T*>(m->data() + o), d);
+}
+
+//-----------------------------------------------------------------------------
+
+}  // namespace xio_details
+
+//-----------------------------------------------------------------------------
+
+using xio_details::map_view;
+using xio_details::xmap;
+
+//-----------------------------------------------------------------------------
+
+}  // namespace xio
+
+//-----------------------------------------------------------------------------
+
+#endif // XIO_MAP
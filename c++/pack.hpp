@@ -0,0 +1,697 @@
+#include <array>
+#include <atomic>
+#include <complex>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#ifndef XIO_PACK
+#define XIO_PACK
+
+//-----------------------------------------------------------------------------
+
+namespace xio {
+
+//-----------------------------------------------------------------------------
+
+namespace xio_details {
+
+//-----------------------------------------------------------------------------
+// compression methods of blocks; the method preferred for each block is
+// determined by the type of the scalars written, falling back to raw copy
+// if compression is not effective. Scalars are only a hint: all methods
+// are lossless on any data.
+
+enum class pack_method : uint8_t { raw, lz, shuffle, delta };
+
+struct pack_kind
+{
+	pack_method method;
+	size_t width;  // width of scalars in bytes
+};
+
+inline bool operator!=(const pack_kind& a, const pack_kind& b)
+{
+	return a.method != b.method || a.width != b.width;
+}
+
+//-----------------------------------------------------------------------------
+// preferred method for trivial type T: delta coding for integers, byte
+// shuffling for floating point numbers, LZ for bytes and other types; arrays
+// and complex numbers are treated like their scalars
+
+template<typename T, typename = void>
+struct pack_of_t
+{
+	static constexpr pack_kind kind() { return pack_kind{pack_method::lz, 1}; }
+};
+
+template<typename T>
+struct pack_of_t<T, only_if<(std::is_integral<T>{} || std::is_enum<T>{}) &&
+	(sizeof(T) > 1), void>>
+{
+	static constexpr pack_kind kind() { return pack_kind{pack_method::delta, sizeof(T)}; }
+};
+
+template<typename T>
+struct pack_of_t<T, only_if<std::is_floating_point<T>{}, void>>
+{
+	static constexpr pack_kind kind() { return pack_kind{pack_method::shuffle, sizeof(T)}; }
+};
+
+template<typename T, size_t N>
+struct pack_of_t<T[N]> : pack_of_t<T> {};
+
+template<typename T, size_t N>
+struct pack_of_t<std::array<T, N>> : pack_of_t<T> {};
+
+template<typename T>
+struct pack_of_t<std::complex<T>> : pack_of_t<T> {};
+
+template<typename T>
+constexpr pack_kind pack_of() { return pack_of_t<typename std::remove_cv<T>::type>::kind(); }
+
+//-----------------------------------------------------------------------------
+// little-endian unsigned integers, such that compressed data are portable
+
+template<typename U>
+U get_le(const char* p)
+{
+	U x;
+	std::memcpy(&x, p, sizeof(U));
+	if(!little()) std::reverse(reinterpret_cast<char*>(&x), reinterpret_cast<char*>(&x + 1));
+	return x;
+}
+
+template<typename U>
+void put_le(char* p, U x)
+{
+	if(!little()) std::reverse(reinterpret_cast<char*>(&x), reinterpret_cast<char*>(&x + 1));
+	std::memcpy(p, &x, sizeof(U));
+}
+
+//-----------------------------------------------------------------------------
+// LZ compression, as a sequence of (literals, match) pairs, each starting
+// with a token of 4-bit literal length and 4-bit match length, followed by
+// length extensions, literals and 16-bit match offset; the last pair may
+// have no match. Compression returns 0 if `cap` bytes are not enough, and
+// decompression returns false on invalid input.
+
+constexpr size_t lz_min() { return 4; }
+
+inline char* lz_len(char* o, const char* e, size_t n)
+{
+	for(; n >= 255; n -= 255) { if(o == e) return nullptr; *o++ = char(255); }
+	if(o == e) return nullptr;
+	*o++ = char(n); return o;
+}
+
+inline size_t lz_encode(const char* in, size_t n, char* out, size_t cap)
+{
+	const size_t bits = 14;
+	std::vector<uint32_t> table(1 << bits, uint32_t(-1));
+	char* o = out;
+	const char* e = out + cap;
+	size_t i = 0, a = 0;
+
+	auto emit = [&](size_t lit, size_t off, size_t len) -> bool
+	{
+		if(o == e) return false;
+		size_t m = len ? len - lz_min() : 0;
+		*o++ = char(std::min(lit, size_t(15)) << 4 | std::min(m, size_t(15)));
+		if(lit >= 15 && !(o = lz_len(o, e, lit - 15))) return false;
+		if(size_t(e - o) < lit) return false;
+		std::memcpy(o, in + a, lit); o += lit;
+		if(!len) return true;
+		if(e - o < 2) return false;
+		*o++ = char(off); *o++ = char(off >> 8);
+		return m < 15 || (o = lz_len(o, e, m - 15));
+	};
+
+	while(i + lz_min() <= n)
+	{
+		uint32_t& r = table[get_le<uint32_t>(in + i) * 2654435761u >> (32 - bits)];
+		size_t ref = r;
+		r = uint32_t(i);
+		if(ref != uint32_t(-1) && i - ref < 1 << 16 && !std::memcmp(in + ref, in + i, lz_min()))
+		{
+			size_t len = lz_min();
+			while(i + len < n && in[ref + len] == in[i + len]) ++len;
+			if(!emit(i - a, i - ref, len)) return 0;
+			a = i += len;
+		}
+		else i += 1 + ((i - a) >> 6);
+	}
+	if(a < n && !emit(n - a, 0, 0)) return 0;
+	return o - out;
+}
+
+inline bool lz_decode(const char* in, size_t n, char* out, size_t raw)
+{
+	const uint8_t* p = reinterpret_cast<const uint8_t*>(in);
+	const uint8_t* e = p + n;
+	char* o = out;
+	char* f = out + raw;
+
+	auto len = [&](size_t& l) -> bool
+	{
+		for(uint8_t b = 255; b == 255; l += b) { if(p == e) return false; b = *p++; }
+		return true;
+	};
+
+	while(p < e)
+	{
+		uint8_t t = *p++;
+		size_t lit = t >> 4, m = (t & 15) + lz_min();
+		if(lit == 15 && !len(lit)) return false;
+		if(size_t(e - p) < lit || size_t(f - o) < lit) return false;
+		std::memcpy(o, p, lit); o += lit; p += lit;
+		if(p == e) break;
+
+		if(e - p < 2) return false;
+		size_t off = p[0] | p[1] << 8; p += 2;
+		if((t & 15) == 15 && !len(m)) return false;
+		if(!off || off > size_t(o - out) || size_t(f - o) < m) return false;
+		const char* r = o - off;
+		if(off >= m) std::memcpy(o, r, m);
+		else for(size_t j = 0; j < m; ++j) o[j] = r[j];
+		o += m;
+	}
+	return o == f;
+}
+
+//-----------------------------------------------------------------------------
+// byte shuffling: byte j of all scalars of width `w` are grouped together,
+// followed by remaining bytes, such that similar bytes are compressed better
+
+inline void shuffle(const char* in, size_t n, char* out, size_t w)
+{
+	size_t k = n / w;
+	for(size_t j = 0; j < w; ++j)
+		for(size_t i = 0; i < k; ++i) out[j * k + i] = in[i * w + j];
+	std::memcpy(out + k * w, in + k * w, n - k * w);
+}
+
+inline void unshuffle(const char* in, size_t n, char* out, size_t w)
+{
+	size_t k = n / w;
+	for(size_t j = 0; j < w; ++j)
+		for(size_t i = 0; i < k; ++i) out[i * w + j] = in[j * k + i];
+	std::memcpy(out + k * w, in + k * w, n - k * w);
+}
+
+//-----------------------------------------------------------------------------
+// delta coding of unsigned integers U, zigzag-encoded such that small
+// negative differences remain small, and bit-packed in frames of up to 128
+// differences with a common bit width, stored in one byte before each frame;
+// followed by remaining bytes
+
+constexpr size_t delta_frame() { return 128; }
+
+template<typename U>
+size_t delta_encode(const char* in, size_t n, char* out, size_t cap)
+{
+	const size_t w = sizeof(U), k = n / w, bits = 8 * w;
+	char* o = out;
+	const char* e = out + cap;
+	U prev = 0, z[delta_frame()];
+
+	for(size_t i = 0; i < k; i += delta_frame())
+	{
+		size_t c = std::min(k - i, delta_frame()), b = 0;
+		U all = 0;
+		for(size_t j = 0; j < c; ++j)
+		{
+			U x = get_le<U>(in + (i + j) * w), d = U(x - prev);
+			all |= z[j] = U(U(d << 1) ^ U(U(0) - U(d >> (bits - 1))));
+			prev = x;
+		}
+		while(b < bits && U(all >> b)) ++b;
+
+		size_t m = (c * b + 7) / 8;
+		if(size_t(e - o) < 1 + m) return 0;
+		*o++ = char(b);
+		std::memset(o, 0, m);
+		for(size_t j = 0, q = 0; j < c; ++j)
+			for(size_t r = 0, t; r < b; r += t, q += t)
+			{
+				t = std::min(b - r, 8 - q % 8);
+				o[q / 8] |= char((uint64_t(z[j]) >> r & ((1u << t) - 1)) << q % 8);
+			}
+		o += m;
+	}
+
+	if(size_t(e - o) < n - k * w) return 0;
+	std::memcpy(o, in + k * w, n - k * w);
+	return o + n - k * w - out;
+}
+
+template<typename U>
+bool delta_decode(const char* in, size_t n, char* out, size_t raw)
+{
+	const size_t w = sizeof(U), k = raw / w, bits = 8 * w;
+	const char* p = in;
+	const char* e = in + n;
+	U prev = 0;
+
+	for(size_t i = 0; i < k; i += delta_frame())
+	{
+		if(p == e) return false;
+		size_t c = std::min(k - i, delta_frame()), b = uint8_t(*p++);
+		size_t m = (c * b + 7) / 8;
+		if(b > bits || size_t(e - p) < m) return false;
+		for(size_t j = 0, q = 0; j < c; ++j)
+		{
+			uint64_t z = 0;
+			for(size_t r = 0, t; r < b; r += t, q += t)
+			{
+				t = std::min(b - r, 8 - q % 8);
+				z |= uint64_t(uint8_t(p[q / 8]) >> q % 8 & ((1u << t) - 1)) << r;
+			}
+			U d = U(U(z >> 1) ^ U(U(0) - U(z & 1)));
+			put_le<U>(out + (i + j) * w, prev = U(prev + d));
+		}
+		p += m;
+	}
+
+	if(size_t(e - p) != raw - k * w) return false;
+	std::memcpy(out + k * w, p, raw - k * w);
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// block header, 12 bytes: uncompressed and compressed size, method and
+// scalar width
+
+struct pack_head
+{
+	uint32_t raw, size;
+	pack_method method;
+	uint8_t width;
+};
+
+constexpr size_t head_size() { return 12; }
+
+inline void put_head(char* p, const pack_head& h)
+{
+	put_le(p, h.raw); put_le(p + 4, h.size);
+	p[8] = char(h.method); p[9] = char(h.width); p[10] = p[11] = 0;
+}
+
+inline bool get_head(const char* p, pack_head& h)
+{
+	h.raw = get_le<uint32_t>(p); h.size = get_le<uint32_t>(p + 4);
+	h.method = pack_method(p[8]); h.width = uint8_t(p[9]);
+	return h.raw && h.raw <= pack_size() && h.width &&
+		h.method <= pack_method::delta &&
+		(h.method == pack_method::raw ? h.size == h.raw : h.size < h.raw);
+}
+
+//-----------------------------------------------------------------------------
+// compress `n` bytes from `in` to `out` of capacity `n`, preferably by
+// method `k`, setting block header `h`; `tmp` is scratch space
+
+inline void pack_block(pack_kind k, const char* in, size_t n, char* out,
+	raw_vector<char>& tmp, pack_head& h)
+{
+	size_t r = 0;
+	h.method = k.method;
+	h.width = uint8_t(k.width);
+
+	if(k.method == pack_method::delta)
+		switch(k.width)
+		{
+			case 2: r = delta_encode<uint16_t>(in, n, out, n); break;
+			case 4: r = delta_encode<uint32_t>(in, n, out, n); break;
+			case 8: r = delta_encode<uint64_t>(in, n, out, n); break;
+		}
+	else if(k.method == pack_method::shuffle)
+	{
+		tmp.resize(n);
+		shuffle(in, n, tmp.data(), k.width);
+		r = lz_encode(tmp.data(), n, out, n);
+	}
+	if(!r && k.method != pack_method::shuffle)
+	{
+		h.method = pack_method::lz;
+		r = lz_encode(in, n, out, n);
+	}
+	if(!r || r >= n)
+	{
+		h.method = pack_method::raw;
+		std::memcpy(out, in, r = n);
+	}
+	h.raw = uint32_t(n);
+	h.size = uint32_t(r);
+}
+
+// decompress block of header `h` from `in` to `out`; false if invalid
+inline bool unpack_block(const pack_head& h, const char* in, char* out,
+	raw_vector<char>& tmp)
+{
+	switch(h.method)
+	{
+		case pack_method::raw:
+			std::memcpy(out, in, h.raw);
+			return true;
+		case pack_method::lz:
+			return lz_decode(in, h.size, out, h.raw);
+		case pack_method::shuffle:
+			tmp.resize(h.raw);
+			if(!lz_decode(in, h.size, tmp.data(), h.raw)) return false;
+			unshuffle(tmp.data(), h.raw, out, h.width);
+			return true;
+		case pack_method::delta:
+			switch(h.width)
+			{
+				case 2: return delta_decode<uint16_t>(in, h.size, out, h.raw);
+				case 4: return delta_decode<uint32_t>(in, h.size, out, h.raw);
+				case 8: return delta_decode<uint64_t>(in, h.size, out, h.raw);
+			}
+	}
+	return false;
+}
+
+//-----------------------------------------------------------------------------
+// pool of threads started once and shared by all callers, such that
+// concurrent work never creates threads per call. Each call runs f(i) for i
+// in [0, n) on the calling thread, helped by idle pool threads, and returns
+// when all are done; f should not throw.
+
+class work_pool
+{
+	std::mutex m;
+	std::condition_variable cv;
+	std::deque<std::function<void()>> q;
+	std::vector<std::thread> t;
+	bool quit;
+
+	void work()
+	{
+		std::unique_lock<std::mutex> l(m);
+		for(;;)
+		{
+			cv.wait(l, [this] { return quit || !q.empty(); });
+			if(q.empty()) return;
+			std::function<void()> g = std::move(q.front());
+			q.pop_front();
+			l.unlock(); g(); l.lock();
+		}
+	}
+
+public:
+	explicit work_pool(size_t n) : quit(false)
+	{
+		for(size_t i = 0; i < n; ++i) t.emplace_back(&work_pool::work, this);
+	}
+
+	work_pool(const work_pool&) = delete;
+
+	~work_pool()
+	{
+		{ std::lock_guard<std::mutex> l(m); quit = true; }
+		cv.notify_all();
+		for(auto& x : t) x.join();
+	}
+
+	// number of pool threads
+	size_t size() const { return t.size(); }
+
+	void run(size_t n, const std::function<void(size_t)>& f)
+	{
+		// shared with helpers, which may start after all work is done
+		struct state
+		{
+			std::atomic<size_t> next{0};
+			size_t done = 0;
+			std::mutex m;
+			std::condition_variable cv;
+		};
+		auto s = std::make_shared<state>();
+		const std::function<void(size_t)>* g = &f;
+		auto loop = [s, g, n]
+		{
+			for(size_t i; (i = s->next++) < n;)
+			{
+				(*g)(i);
+				std::lock_guard<std::mutex> l(s->m);
+				if(++s->done == n) s->cv.notify_all();
+			}
+		};
+
+		size_t k = std::min(n ? n - 1 : 0, t.size());
+		if(k)
+		{
+			{ std::lock_guard<std::mutex> l(m); for(size_t i = 0; i < k; ++i) q.push_back(loop); }
+			cv.notify_all();
+		}
+		loop();
+		std::unique_lock<std::mutex> l(s->m);
+		s->cv.wait(l, [&] { return s->done == n; });
+	}
+};
+
+// shared pool of one thread less than hardware threads
+inline work_pool& shared_pool()
+{
+	static work_pool p(std::max(std::thread::hardware_concurrency(), 1u) - 1);
+	return p;
+}
+
+//-----------------------------------------------------------------------------
+// number of blocks of a large read decompressed inline rather than by the
+// shared pool
+
+constexpr size_t pack_inline() { return 2; }
+
+//-----------------------------------------------------------------------------
+// output stream compressing data written to underlying stream `s` in blocks
+// of pack_size() bytes, each with a header. The method of each block is
+// chosen by the type of data given to w_mem(); small writes (e.g. sizes)
+// do not change it.
+
+template<typename S>
+class pack_ostream
+{
+	S& s;
+	raw_vector<char> buf, zip, tmp;
+	size_t len;
+	uint64_t pos;
+	pack_kind cur;
+
+	static constexpr size_t small() { return 64; }
+
+	void flush()
+	{
+		if(!len) return;
+		pack_head h;
+		pack_block(cur, buf.data(), len, zip.data() + head_size(), tmp, h);
+		put_head(zip.data(), h);
+		s.write(zip.data(), head_size() + h.size);
+		len = 0;
+	}
+
+public:
+	using char_type = char;
+
+	pack_ostream(S& s) :
+		s(s), buf(pack_size()), zip(head_size() + pack_size()),
+		len(0), pos(0), cur{pack_method::lz, 1} {}
+
+	void put(const char* p, size_t k, pack_kind c)
+	{
+		if(k >= small() && c != cur) { if(len >= small()) flush(); cur = c; }
+		for(size_t m; k; p += m, k -= m, pos += m)
+		{
+			m = std::min(k, buf.size() - len);
+			std::memcpy(buf.data() + len, p, m);
+			if((len += m) == buf.size()) flush();
+		}
+	}
+
+	pack_ostream& write(const char_type* p, std::streamsize k)
+	{
+		put(p, k, pack_of<char>()); return *this;
+	}
+
+	// position in uncompressed data
+	std::streamoff tellp() const { return pos; }
+
+	void close() { flush(); }
+
+	explicit operator bool() const { return bool(s); }
+	bool operator!() const { return !s; }
+};
+
+template<typename S, typename T>
+void w_mem(pack_ostream<S>& s, const T* base, size_t size = 1)
+{
+	XIO_STATS_IO(size * sizeof(T));
+	s.put(reinterpret_cast<const char*>(base), size * sizeof(T), pack_of<T>());
+}
+
+//-----------------------------------------------------------------------------
+// input stream decompressing data from underlying stream `s`. Blocks are
+// indexed as they are encountered, so seeking by position in uncompressed
+// data only decompresses the blocks actually read (e.g. by partial loading).
+// Large reads decompress consecutive blocks directly into the destination,
+// concurrently by a pool of threads shared by all streams.
+
+template<typename S>
+class pack_istream
+{
+	struct entry { uint64_t raw; std::streamoff file; };
+
+	S& s;
+	std::streamoff base, at, next;
+	std::vector<entry> index;
+	raw_vector<char> buf, zip, tmp;
+	uint64_t end, cur, len, pos;
+	size_t last;
+	bool ok;
+
+	// file positions are relative to `base`; `at` is that of `s`, or -1 if
+	// unknown; `next` is that of the first block not indexed, and `end` the
+	// position of its data; `cur`, `len` are those of block in buffer
+
+	void seek(std::streamoff o) { if(at != o) { s.seekg(base + o); at = o; } }
+
+	bool head(std::streamoff o, pack_head& h)
+	{
+		char p[head_size()];
+		seek(o);
+		s.read(p, head_size());
+		if(!s) { s.clear(); at = -1; return false; }
+		at += head_size();
+		return get_head(p, h);
+	}
+
+	bool scan(pack_head& h)
+	{
+		if(!head(next, h)) return false;
+		index.push_back(entry{end, next});
+		next += head_size() + h.size;
+		end += h.raw;
+		return true;
+	}
+
+	bool load(const pack_head& h, uint64_t r)
+	{
+		zip.resize(h.size);
+		s.read(zip.data(), h.size);
+		if(!s) { at = -1; return false; }
+		at += h.size;
+		cur = r; len = 0;
+		if(!unpack_block(h, zip.data(), buf.data(), tmp)) return false;
+		len = h.raw;
+		return true;
+	}
+
+	// load block containing current position, if not in buffer
+	bool fill()
+	{
+		pack_head h;
+		if(pos >= cur && pos < cur + len) return true;
+		if(pos < end)
+		{
+			auto i = std::upper_bound(index.begin(), index.end(), pos,
+				[](uint64_t p, const entry& e) { return p < e.raw; }) - 1;
+			return head(i->file, h) && load(h, i->raw);
+		}
+		while(scan(h))
+			if(pos < end) return load(h, end - h.raw);
+		return false;
+	}
+
+	// read unindexed blocks fitting in `n` bytes to `p`, decompressing
+	// concurrently by the shared pool if more than pack_inline() blocks;
+	// returns bytes read
+	size_t bulk(char* p, size_t n)
+	{
+		struct job { pack_head h; raw_vector<char> zip; char* out; };
+		work_pool& w = shared_pool();
+		size_t t = w.size() + 1, k = 0;
+		std::vector<job> jobs;
+		pack_head h;
+
+		while(jobs.size() < 2 * t && scan(h))
+		{
+			if(h.raw > n - k) { ok = load(h, end - h.raw); break; }
+			jobs.push_back(job{h, raw_vector<char>(h.size), p + k});
+			s.read(jobs.back().zip.data(), h.size);
+			if(!s) { at = -1; ok = false; return 0; }
+			at += h.size;
+			k += h.raw;
+		}
+
+		std::atomic<bool> done(true);
+		XIO_STATS_FORK();
+		auto run = [&](size_t i)
+		{
+			XIO_STATS_JOIN();
+			raw_vector<char> tmp;
+			const job& j = jobs[i];
+			if(!unpack_block(j.h, j.zip.data(), j.out, tmp)) done = false;
+		};
+
+		if(jobs.size() <= pack_inline() || t == 1)
+			for(size_t i = 0; i < jobs.size(); ++i) run(i);
+		else w.run(jobs.size(), run);
+		if(!done) ok = false;
+		return done ? k : 0;
+	}
+
+public:
+	using char_type = char;
+
+	pack_istream(S& s) :
+		s(s), base(s.tellg()), at(0), next(0), buf(pack_size()),
+		end(0), cur(0), len(0), pos(0), last(0), ok(true) {}
+
+	pack_istream& read(char_type* p, std::streamsize n)
+	{
+		last = 0;
+		for(size_t m; ok && n > 0; p += m, n -= m, pos += m, last += m)
+		{
+			if(pos == end && size_t(n) >= pack_size() && (m = bulk(p, n))) continue;
+			if(!ok || !fill()) { ok = false; break; }
+			m = std::min(size_t(n), size_t(cur + len - pos));
+			std::memcpy(p, buf.data() + (pos - cur), m);
+		}
+		return *this;
+	}
+
+	std::streamsize gcount() const { return last; }
+
+	// positions in uncompressed data
+	std::streamoff tellg() const { return pos; }
+
+	pack_istream& seekg(std::streamoff o) { pos = o; return *this; }
+
+	pack_istream& seekg(std::streamoff o, std::ios_base::seekdir d)
+	{
+		pack_head h;
+		if(d == std::ios_base::end) while(scan(h)) {}
+		pos = o + (d == std::ios_base::beg ? 0 : d == std::ios_base::cur ? pos : end);
+		return *this;
+	}
+
+	explicit operator bool() const { return ok; }
+	bool operator!() const { return !ok; }
+	void clear() { ok = true; s.clear(); }
+};
+
+//-----------------------------------------------------------------------------
+
+}  // namespace xio_details
+
+//-----------------------------------------------------------------------------
+
+}  // namespace xio
+
+//-----------------------------------------------------------------------------
+
+#endif // XIO_PACK
@@ -0,0 +1,371 @@
+#include <algorithm>
+#include <numeric>
+#include <thread>
+#include <atomic>
+#include <functional>
+
+#ifndef XIO_PAR
+#define XIO_PAR
+
+//-----------------------------------------------------------------------------
+
+namespace xio {
+
+//-----------------------------------------------------------------------------
+// executor running f(i) concurrently for i in [0, n), returning when all
+// calls are complete; the default one spawns n - 1 threads
+
+using executor = std::function<void(size_t, const std::function<void(size_t)>&)>;
+
+//-----------------------------------------------------------------------------
+// options of parallel file operations: maximum number of threads; minimum
+// segment size in bytes per thread; optional executor
+
+struct par
+{
+	size_t threads;
+	size_t segment;
+	executor exec;
+
+	par(size_t threads = std::thread::hardware_concurrency(),
+		size_t segment = 1 << 24, executor exec = executor()) :
+		threads(threads), segment(segment), exec(exec) {}
+};
+
+//-----------------------------------------------------------------------------
+
+namespace xio_details {
+
+//-----------------------------------------------------------------------------
+// default executor
+
+inline void spawn(size_t n, const std::function<void(size_t)>& f)
+{
+	std::vector<std::thread> t;
+	for(size_t i = 1; i < n; ++i) t.emplace_back(f, i);
+	if(n) f(0);
+	for(auto& x : t) x.join();
+}
+
+//-----------------------------------------------------------------------------
+// transfer `n` bytes between memory at `p` and file at offset `o` by
+// function `io` (pread_all or pwrite_all), split into segments transferred
+// concurrently; return true if complete
+
+template<typename C, typename IO>
+bool p_io(const par& x, IO io, int fd, C* p, size_t n, off_t o)
+{
+	size_t k = std::max(size_t(1), std::min(x.threads, n / std::max(x.segment, size_t(1))));
+	if(k == 1) { XIO_STATS_IO(n); return io(fd, p, n, o) == n; }
+
+	std::atomic<bool> ok(true);
+	size_t l = round_up((n + k - 1) / k, block_size());
+	executor e = x.exec ? x.exec : executor(spawn);
+	XIO_STATS_FORK();
+	e(k, [&](size_t i)
+	{
+		XIO_STATS_JOIN();
+		size_t b = std::min(n, i * l), m = std::min(n - b, l);
+		XIO_STATS_IO(m);
+		if(io(fd, p + b, m, o + b) != m) ok = false;
+	});
+	return ok;
+}
+
+//-----------------------------------------------------------------------------
+// parallel serialization of contiguous ranges of trivial elements: the
+// dimensions are serialized on the stream, then elements are transferred
+// directly between memory and file and the stream skips them; sequential
+// serialization otherwise
+
+template<typename F, typename S, typename A, only_if<is_bulk<A>{}> = 0>
+void p_read(const par& x, const F& f, S& s, A& a)
+{
+	size_t n = r_dims(_true(), s, a) * sizeof(elem<A>);
+	off_t o = s.tellg();
+	if(!s || (n && !p_io(x, pread_all, s.handle(), reinterpret_cast<char*>(base(a)), n, o)))
+		throw e_read(f);
+	s.seekg(o + n);
+}
+
+template<typename F, typename S, typename A, only_if<is_bulk<A>{}> = 0>
+void p_write(const par& x, const F& f, S& s, const A& a)
+{
+	size_t n = size(a) * sizeof(elem<A>);
+	w_dims(_true(), s, a);
+	off_t o = s.tellp();
+	s.reserve(o + n); s.skip(n);
+	if(n && !p_io(x, pwrite_all, s.handle(), reinterpret_cast<const char*>(base(a)), n, o))
+		throw e_write(f);
+}
+
+//-----------------------------------------------------------------------------
+// streams reading or writing consecutive bytes of file descriptor `fd` from
+// offset `o` by pread/pwrite through a buffer, where transfers at least as
+// large as the buffer bypass it; each thread of a parallel serialization
+// uses its own stream on a disjoint segment [o, e) of the same file
+
+class p_istream
+{
+	int fd;
+	off_t pos, end;  // file position of buffer, end of segment
+	raw_vector<char> buf;
+	size_t i, n;     // read position and data length in buffer
+	bool ok;
+
+public:
+	using char_type = char;
+
+	p_istream(int fd, off_t o, off_t e) :
+		fd(fd), pos(o), end(e), buf(buffer_size()), i(0), n(0), ok(true) {}
+
+	p_istream& read(char_type* p, std::streamsize k)
+	{
+		while(ok && k)
+		{
+			if(i == n)
+			{
+				pos += n; i = n = 0;
+				if(size_t(k) >= buf.size())
+				{
+					ok = pread_all(fd, p, k, pos) == size_t(k);
+					pos += k; break;
+				}
+				n = pread_all(fd, buf.data(), std::min(buf.size(), size_t(std::max(end - pos, off_t(0)))), pos);
+				if(!n) { ok = false; break; }
+			}
+			size_t m = std::min(size_t(k), n - i);
+			std::memcpy(p, buf.data() + i, m);
+			i += m; p += m; k -= m;
+		}
+		return *this;
+	}
+
+	explicit operator bool() const { return ok; }
+	bool operator!() const { return !ok; }
+};
+
+class p_ostream
+{
+	int fd;
+	off_t pos;  // file position of buffer
+	raw_vector<char> buf;
+	size_t n;   // data length in buffer
+	bool ok;
+
+public:
+	using char_type = char;
+
+	p_ostream(int fd, off_t o) : fd(fd), pos(o), buf(buffer_size()), n(0), ok(true) {}
+
+	p_ostream& write(const char_type* p, std::streamsize k)
+	{
+		if(n + k > buf.size()) flush();
+		if(size_t(k) < buf.size()) { std::memcpy(buf.data() + n, p, k); n += k; }
+		else { ok = ok && pwrite_all(fd, p, k, pos) == size_t(k); pos += k; }
+		return *this;
+	}
+
+	void flush()
+	{
+		ok = ok && pwrite_all(fd, buf.data(), n, pos) == n;
+		pos += n; n = 0;
+	}
+
+	explicit operator bool() const { return ok; }
+	bool operator!() const { return !ok; }
+};
+
+//-----------------------------------------------------------------------------
+// number of threads serializing `n` bytes of `k` elements
+
+inline size_t p_threads(const par& x, uint64_t n, size_t k)
+{
+	return std::max(size_t(1), std::min({x.threads, k, size_t(n / std::max(x.segment, size_t(1)))}));
+}
+
+// first element of each of `k` segments of about equal size in bytes, given
+// offsets `o` of all elements relative to the first, followed by the end
+inline std::vector<size_t> p_split(const std::vector<uint64_t>& o, size_t k)
+{
+	std::vector<size_t> b(k + 1, o.size() - 1);
+	for(size_t i = 0; i < k; ++i)
+		b[i] = std::lower_bound(o.begin(), o.end() - 1, o.back() / k * i) - o.begin();
+	return b;
+}
+
+//-----------------------------------------------------------------------------
+// resizable contiguous range of contiguous ranges of trivial elements, e.g.
+// std::vector<std::vector<float>>; false for any other type
+
+template<typename A, bool = is_nested<A>{}>
+struct is_nested_bulk_t : expr<is_bulk<elem<A>>{} && !is_fixed<A>{}> {};
+
+template<typename A>
+struct is_nested_bulk_t<A, false> : _false {};
+
+template<typename A>
+using is_nested_bulk = expr<is_nested_bulk_t<A>{}>;
+
+//-----------------------------------------------------------------------------
+// parallel serialization of contiguous ranges of non-trivial elements, e.g.
+// nested containers, in two passes. On writing, the size of each element is
+// computed by a dry run and offsets by prefix sum, then space is reserved
+// and elements are written concurrently in segments of about equal size in
+// bytes. On reading, if
+// elements are contiguous ranges of trivial elements, offsets are found by
+// reading the dimensions of each element and skipping its elements, then
+// elements are read concurrently in segments. The format is unchanged.
+
+template<typename F, typename S, typename A, only_if<is_nested_bulk<A>{}> = 0>
+void p_read(const par& x, const F& f, S& s, A& a)
+{
+	using T = elem<elem<A>>;
+	size_t n = r_dims(_true(), s, a);
+	a.resize(n);
+
+	// offsets, as in m_parse() of many.hpp for the dimensions of one element
+	std::vector<uint64_t> o(n + 1);
+	off_t q = s.tellg();
+	if(n)
+	{
+		auto&& d = dims(a[0]);
+		typename std::decay<decltype(d)>::type e = d;
+		for(size_t i = 0; i < n && s; ++i)
+		{
+			xread(s, e);
+			o[i + 1] = s.tellg() - q + total(e) * sizeof(T);
+			s.seekg(q + o[i + 1]);
+		}
+	}
+	if(!s) throw e_read(f);
+
+	size_t k = p_threads(x, o[n], n);
+	std::vector<size_t> b = p_split(o, k);
+	std::atomic<bool> ok(true);
+	executor ex = x.exec ? x.exec : executor(spawn);
+	XIO_STATS_FORK();
+	ex(k, [&](size_t t)
+	{
+		XIO_STATS_JOIN();
+		p_istream r(s.handle(), q + o[b[t]], q + o[b[t + 1]]);
+		for(size_t i = b[t]; i < b[t + 1] && r; ++i) xread(r, a[i]);
+		if(!r) ok = false;
+	});
+	if(!ok) throw e_read(f);
+}
+
+template<typename F, typename S, typename A, only_if<is_nested<A>{}> = 0>
+void p_write(const par& x, const F& f, S& s, const A& a)
+{
+	size_t n = size(a);
+	auto p = base(a);
+	std::vector<uint64_t> o(n + 1);
+	executor ex = x.exec ? x.exec : executor(spawn);
+
+	// sizes of elements: sequentially up to about one segment, then the rest
+	// concurrently by as many threads as their estimated total size allows
+	size_t i = 0;
+	uint64_t m = 0;
+	for(; i < n && (!i || m < x.segment); ++i) { counter c; xwrite(c, p[i]); m += o[i + 1] = c.n; }
+	if(i < n)
+	{
+		size_t h = p_threads(x, m / i * n, n - i);
+		ex(h, [&](size_t t)
+		{
+			for(size_t j = i + (n - i) * t / h; j < i + (n - i) * (t + 1) / h; ++j)
+				{ counter c; xwrite(c, p[j]); o[j + 1] = c.n; }
+		});
+	}
+	std::partial_sum(o.begin(), o.end(), o.begin());
+
+	w_dims(_true(), s, a);
+	off_t q = s.tellp();
+	s.reserve(q + o[n]); s.skip(o[n]);
+
+	size_t k = p_threads(x, o[n], n);
+	std::vector<size_t> b = p_split(o, k);
+	std::atomic<bool> ok(true);
+	XIO_STATS_FORK();
+	ex(k, [&](size_t t)
+	{
+		XIO_STATS_JOIN();
+		p_ostream w(s.handle(), q + o[b[t]]);
+		for(size_t i = b[t]; i < b[t + 1]; ++i) xwrite(w, p[i]);
+		w.flush();
+		if(!w) ok = false;
+	});
+	if(!ok) throw e_write(f);
+}
+
+template<typename F, typename S, typename A, only_if<!is_bulk<A>{} && !is_nested_bulk<A>{}> = 0>
+void p_read(const par&, const F&, S& s, A& a) { xread(s, a); }
+
+template<typename F, typename S, typename A, only_if<!is_bulk<A>{} && !is_nested<A>{}> = 0>
+void p_write(const par&, const F&, S& s, const A& a) { xwrite(s, a); }
+
+//-----------------------------------------------------------------------------
+// multi-argument generalizations
+
+template<typename F, typename S, typename A, typename B, typename... C>
+void p_read(const par& x, const F& f, S& s, A& a, B& b, C&... c)
+{
+	p_read(x, f, s, a); p_read(x, f, s, b, c...);
+}
+
+template<typename F, typename S, typename A, typename B, typename... C>
+void p_write(const par& x, const F& f, S& s, const A& a, const B& b, const C&... c)
+{
+	p_write(x, f, s, a); p_write(x, f, s, b, c...);
+}
+
+//-----------------------------------------------------------------------------
+// parallel file operations, using file descriptor streams; on saving, file
+// space is reserved for each object written in parallel, once its size in
+// bytes is known. Files of non-native byte order are loaded sequentially,
+// and so are files with checksums and compressed files, although the blocks
+// of the latter are decompressed concurrently.
+
+template<>
+struct is_option<par> : _true {};
+
+template<typename F, typename A, typename... B>
+void xload(const par& x, const F& f, A& a, B&... b)
+{
+	XIO_STATS_CALL("load");
+	posix o(buffer_size());
+	fd_istream s(o);
+	header h;
+	xopen(s, f); r_head(s, h, f); r_head_type<A>(h, f);
+	if(h.swapped() || h.packed() || h.check)
+		{ if(!r_body(s, h, a, b...)) throw e_read(f); }
+	else { p_read(x, f, s, a, b...); if(!s) throw e_read(f); }
+}
+
+template<typename F, typename A, typename... B>
+void xsave(const par& x, const F& f, const A& a, const B&... b)
+{
+	XIO_STATS_CALL("save");
+	posix o(buffer_size());
+	fd_ostream s(o);
+	xopen(s, f); p_write(x, f, s, a, b...);
+	s.close();
+	if(!s) throw e_write(f);
+}
+
+//-----------------------------------------------------------------------------
+
+}  // namespace xio_details
+
+//-----------------------------------------------------------------------------
+
+using xio_details::xload;
+using xio_details::xsave;
+
+//-----------------------------------------------------------------------------
+
+}  // namespace xio
+
+//-----------------------------------------------------------------------------
+
+#endif // XIO_PAR
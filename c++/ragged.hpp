@@ -0,0 +1,258 @@
+#ifndef XIO_RAGGED
+#define XIO_RAGGED
+
+//-----------------------------------------------------------------------------
+
+namespace xio {
+
+//-----------------------------------------------------------------------------
+
+namespace xio_details {
+
+//-----------------------------------------------------------------------------
+// invalid ragged array exception
+
+struct e_ragged : std::exception
+{
+	const char* what() const noexcept override
+	{
+		return "invalid offsets of ragged array\n";
+	}
+};
+
+//-----------------------------------------------------------------------------
+// ragged ("CSR") layout of a nested range `a` with trivial elements in inner
+// ranges, e.g. std::vector<std::vector<int>> or std::vector<std::string>:
+// stored as two arrays, the n+1 offsets of the inner ranges and the
+// concatenation of all inner ranges, rather than each inner range with its
+// own size. Only used when explicitly requested by wrapping `a`.
+
+template<typename A>
+struct ragged_t
+{
+	A& a;
+	ragged_t(A& a) : a(a) {}
+};
+
+// const, so that a temporary can be read into
+template<typename A>
+const ragged_t<A> ragged(A& a) { return ragged_t<A>(a); }
+
+//-----------------------------------------------------------------------------
+// check offsets `o` and payload size `m` read
+
+inline void r_offsets(const uint64_t* b, const uint64_t* e, uint64_t m)
+{
+	if(b == e || *b || e[-1] != m) throw e_ragged();
+	for(; ++b != e;) if(*b < b[-1]) throw e_ragged();
+}
+
+//-----------------------------------------------------------------------------
+// store `k` elements at `p` to inner range `a` from position `i`, where `a`
+// has been resized; appended to `a` if not contiguous
+
+template<typename A, typename T, only_if<is_contig<A>{}> = 0>
+void r_part(A& a, size_t i, const T* p, size_t k) { std::copy(p, p + k, base(a) + i); }
+
+template<typename A, typename T, only_if<!is_contig<A>{}> = 0>
+void r_part(A& a, size_t, const T* p, size_t k) { insert(a, p, p + k); }
+
+//-----------------------------------------------------------------------------
+// ragged serialization: inner ranges are staged through a buffer of bounded
+// size, so all inner ranges are read or written in few bulk operations;
+// inner ranges larger than the buffer are copied directly. All inner ranges
+// are resized before reading.
+
+template<typename S, typename A>
+void xread(S& s, const ragged_t<A>& r)
+{
+	using T = elem<elem<A>>;
+	static_assert(is_triv<T>(), "Ragged layout only supported for trivial elements of inner ranges.");
+	XIO_STATS_PATH(ragged);
+
+	std::vector<uint64_t> o;
+	uint64_t m;
+	xread(s, o); xread(s, m);
+	if(!s) return;
+	r_offsets(o.data(), o.data() + o.size(), m);
+
+	A& a = r.a;
+	a.resize(o.size() - 1);
+	raw_vector<T> b(stage_len<T>());
+	size_t at = 0, len = 0, left = m, j = 0;
+
+	for(auto i = std::begin(a), e = std::end(a); i != e; ++i, ++j)
+	{
+		size_t k = o[j + 1] - o[j];
+		resize(*i, k);
+		if(at == len && k >= b.size()) { r_elem_triv(s, *i, k); left -= k; continue; }
+		for(size_t d = 0, c; d < k; d += c, at += c)
+		{
+			if(at == len)
+			{
+				len = std::min(b.size(), left); at = 0; left -= len;
+				r_mem(s, b.data(), len);
+			}
+			c = std::min(k - d, len - at);
+			r_part(*i, d, b.data() + at, c);
+		}
+	}
+}
+
+template<typename S, typename A>
+void xwrite(S& s, const ragged_t<A>& r)
+{
+	using T = elem<elem<A>>;
+	static_assert(is_triv<T>(), "Ragged layout only supported for trivial elements of inner ranges.");
+	XIO_STATS_PATH(ragged);
+
+	const A& a = r.a;
+	std::vector<uint64_t> o(1, 0);
+	o.reserve(size(a) + 1);
+	for(auto& x : a) o.push_back(o.back() + size(x));
+	xwrite(s, o); xwrite(s, o.back());
+
+	raw_vector<T> b(stage_len<T>());
+	size_t len = 0;
+	for(auto& x : a)
+	{
+		size_t k = size(x);
+		if(len + k > b.size()) { w_mem(s, b.data(), len); len = 0; }
+		if(k >= b.size()) w_elem_triv(s, x);
+		else len = std::copy(std::begin(x), std::end(x), b.data() + len) - b.data();
+	}
+	w_mem(s, b.data(), len);
+}
+
+//-----------------------------------------------------------------------------
+// contiguous view of inner range i of a ragged array
+
+template<typename T>
+class ragged_row
+{
+	const T* p;
+	size_t n;
+
+public:
+	ragged_row(const T* p, size_t n) : p(p), n(n) {}
+
+	const T* data() const { return p; }
+	const T* begin() const { return p; }
+	const T* end() const { return p + n; }
+
+	size_t size() const { return n; }
+	const T& operator[](size_t i) const { return p[i]; }
+};
+
+//-----------------------------------------------------------------------------
+// ragged array of elements of type T, holding offsets and concatenated inner
+// ranges in contiguous ranges O, P; in ragged layout, each is read by a
+// single memory copy. If O, P are views of a file mapping, this is a
+// read-only, zero-copy view.
+
+template<typename T, typename O = std::vector<uint64_t>, typename P = raw_vector<T>>
+class ragged_array
+{
+	O o;
+	P p;
+
+public:
+	ragged_array() : o(1, 0) {}
+	ragged_array(const O& o, const P& p) : o(o), p(p) {}
+
+	template<typename R>
+	void push_back(const R& r)
+	{
+		p.insert(p.end(), std::begin(r), std::end(r));
+		o.push_back(p.size());
+	}
+
+	void clear() { o.assign(1, 0); p.clear(); }
+
+	size_t size() const { return o.size() - 1; }
+
+	ragged_row<T> operator[](size_t i) const
+	{
+		return ragged_row<T>(p.data() + o[i], o[i + 1] - o[i]);
+	}
+
+	const O& offsets() const { return o; }
+	const P& values() const { return p; }
+
+	template<typename S, typename U, typename Q, typename R>
+	friend void xread(S& s, ragged_array<U, Q, R>& a);
+};
+
+template<typename S, typename T, typename O, typename P>
+void xread(S& s, ragged_array<T, O, P>& a)
+{
+	xread(s, a.o); xread(s, a.p);
+	if(s) r_offsets(a.o.data(), a.o.data() + a.o.size(), a.p.size());
+}
+
+template<typename S, typename T, typename O, typename P>
+void xwrite(S& s, const ragged_array<T, O, P>& a)
+{
+	xwrite(s, a.offsets()); xwrite(s, a.values());
+}
+
+template<typename T>
+using ragged_view = ragged_array<T, map_view<uint64_t>, map_view<T>>;
+
+//-----------------------------------------------------------------------------
+// map a file holding a single ragged array with elements of type T, as
+// saved by xsave() of ragged() or ragged_array; offsets and elements are
+// not copied. Only uncompressed files of native byte order can be mapped;
+// checksums are not verified.
+
+template<typename T, typename F>
+ragged_view<T> xmap_ragged(const F& f)
+{
+	static_assert(is_triv<T>(), "Only trivially copyable elements can be mapped.");
+
+	std::ifstream s;
+	header h;
+	uint64_t n, m;
+	xopen(s, f); r_head(s, h, f);
+	if(h.swapped() || h.packed()) throw e_format(f);
+	xread(s, n);
+	if(!s) throw e_format(f);
+
+	uint64_t o = s.tellg();
+	auto g = std::make_shared<const mapping>(f);
+	uint64_t z = g->size();
+	if(!n || o > z || n > (z - o) / sizeof(uint64_t)) throw e_format(f);
+	s.seekg(o + n * sizeof(uint64_t));
+	xread(s, m);
+	if(!s) throw e_format(f);
+
+	uint64_t q = s.tellg();
+	if(o % alignof(uint64_t) || q % alignof(T) || m > (z - q) / sizeof(T))
+		throw e_format(f);
+
+	map_view<uint64_t> u(g, reinterpret_cast<const uint64_t*>(g->data() + o), n);
+	map_view<T> v(g, reinterpret_cast<const T*>(g->data() + q), m);
+	r_offsets(u.begin(), u.end(), m);
+	return ragged_view<T>(u, v);
+}
+
+//-----------------------------------------------------------------------------
+
+}  // namespace xio_details
+
+//-----------------------------------------------------------------------------
+
+using xio_details::ragged;
+using xio_details::ragged_array;
+using xio_details::ragged_view;
+using xio_details::xmap_ragged;
+using xio_details::xread;
+using xio_details::xwrite;
+
+//-----------------------------------------------------------------------------
+
+}  // namespace xio
+
+//-----------------------------------------------------------------------------
+
+#endif // XIO_RAGGED
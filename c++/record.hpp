@@ -0,0 +1,418 @@
+#include <tuple>
+#include <cstring>
+
+#ifndef XIO_RECORD
+#define XIO_RECORD
+
+//-----------------------------------------------------------------------------
+// list of fields of a user-defined structure, to be serialized as a record,
+// e.g. struct point { std::string name; double x, y; XIO_FIELDS(name, x, y) };
+// alternatively, a free function xio_fields(a) returning std::tie() of the
+// fields of `a` may be defined, found by argument-dependent lookup
+
+#define XIO_FIELDS(...)                                    \
+	auto xio_fields() -> decltype(std::tie(__VA_ARGS__))     \
+		{ return std::tie(__VA_ARGS__); }                      \
+	auto xio_fields() const -> decltype(std::tie(__VA_ARGS__)) \
+		{ return std::tie(__VA_ARGS__); }
+
+//-----------------------------------------------------------------------------
+
+namespace xio {
+
+//-----------------------------------------------------------------------------
+
+namespace xio_details {
+
+//-----------------------------------------------------------------------------
+// compile-time sequence of indices 0, ..., N - 1
+
+template<size_t... I>
+struct seq {};
+
+template<size_t N, size_t... I>
+struct make_seq_t : make_seq_t<N - 1, N - 1, I...> {};
+
+template<size_t... I>
+struct make_seq_t<0, I...> { using type = seq<I...>; };
+
+template<size_t N>
+using make_seq = typename make_seq_t<N>::type;
+
+//-----------------------------------------------------------------------------
+// fields of a record, as a tuple of references: elements of std::tuple,
+// members of std::pair, or as listed by XIO_FIELDS or xio_fields()
+
+template<typename... T, size_t... I>
+std::tuple<T&...> tuple_refs(std::tuple<T...>& a, seq<I...>)
+	{ return std::tuple<T&...>(std::get<I>(a)...); }
+
+template<typename... T, size_t... I>
+std::tuple<const T&...> tuple_refs(const std::tuple<T...>& a, seq<I...>)
+	{ return std::tuple<const T&...>(std::get<I>(a)...); }
+
+template<typename... T>
+std::tuple<T&...> fields_of(std::tuple<T...>& a)
+	{ return tuple_refs(a, make_seq<sizeof...(T)>()); }
+
+template<typename... T>
+std::tuple<const T&...> fields_of(const std::tuple<T...>& a)
+	{ return tuple_refs(a, make_seq<sizeof...(T)>()); }
+
+template<typename T, typename U>
+std::tuple<T&, U&> fields_of(std::pair<T, U>& a) { return std::tie(a.first, a.second); }
+
+template<typename T, typename U>
+std::tuple<const T&, const U&> fields_of(const std::pair<T, U>& a)
+	{ return std::tie(a.first, a.second); }
+
+template<typename A> using _mem_fields = decltype(gen<A&>().xio_fields());
+template<typename A> using has_mem_fields = sfinae<_mem_fields, A>;
+
+template<typename A, only_if<has_mem_fields<A>{}> = 0>
+auto fields_of(A& a) -> decltype(a.xio_fields()) { return a.xio_fields(); }
+
+template<typename A, only_if<!has_mem_fields<A>{}> = 0>
+auto fields_of(A& a) -> decltype(xio_fields(a)) { return xio_fields(a); }
+
+template<typename A> using fields = decltype(fields_of(gen<A&>()));
+template<typename A> using has_fields = sfinae<fields, A>;
+
+//-----------------------------------------------------------------------------
+// record: type with fields that is not trivially copyable (the latter is
+// still copied as a whole) and not a range
+
+template<typename A, typename>
+struct is_record_t : expr<has_fields<A>{} && !is_triv<A>{} && !is_range<A>{}> {};
+
+//-----------------------------------------------------------------------------
+// number and type of fields in tuple of references R
+
+template<typename R>
+using field_count = std::tuple_size<R>;
+
+template<typename F>
+using bare = typename std::remove_cv<typename std::remove_reference<F>::type>::type;
+
+template<size_t I, typename R>
+using field = bare<typename std::tuple_element<I, R>::type>;
+
+
+//-----------------------------------------------------------------------------
+// flat record: all fields trivial or flat records, so the record has a fixed
+// serialized size, flat_size<A>(), and no dimensions
+
+template<bool... B>
+struct bools {};
+
+template<bool... B>
+using all = std::is_same<bools<true, B...>, bools<B..., true>>;
+
+template<typename A, bool = is_record<A>{}>
+struct flat_t : _false {};
+
+template<typename R>
+struct flat_fields;
+
+template<typename... F>
+struct flat_fields<std::tuple<F...>> :
+	all<(is_triv<bare<F>>{} || flat_t<bare<F>>{})...> {};
+
+template<typename A>
+struct flat_t<A, true> : flat_fields<fields<A>> {};
+
+template<typename A, typename>
+struct is_flat_t : flat_t<A> {};
+
+constexpr size_t sum() { return 0; }
+
+template<typename... N>
+constexpr size_t sum(size_t n, N... m) { return n + sum(m...); }
+
+template<typename A, bool = is_triv<A>{}>
+struct flat_size_t : std::integral_constant<size_t, sizeof(A)> {};
+
+template<typename R>
+struct flat_sum;
+
+template<typename... F>
+struct flat_sum<std::tuple<F...>> :
+	std::integral_constant<size_t, sum(flat_size_t<bare<F>>{}...)> {};
+
+template<typename A>
+struct flat_size_t<A, false> : flat_sum<fields<A>> {};
+
+template<typename A>
+constexpr size_t flat_size() { return flat_size_t<A>{}; }
+
+//-----------------------------------------------------------------------------
+// runs of consecutive trivial fields: end of run starting at field I of R,
+// i.e. first non-trivial field from I on (I if none), and size of run [I, J)
+
+template<typename R, size_t I, size_t N = field_count<R>{}, bool = (I < N)>
+struct run_end : std::integral_constant<size_t, I> {};
+
+template<typename R, size_t I, size_t N>
+struct run_end<R, I, N, true> : std::conditional<is_triv<field<I, R>>{},
+	run_end<R, I + 1, N>, std::integral_constant<size_t, I>>::type {};
+
+template<typename R, size_t I, size_t J>
+struct run_size_t :
+	std::integral_constant<size_t, sizeof(field<I, R>) + run_size_t<R, I + 1, J>{}> {};
+
+template<typename R, size_t J>
+struct run_size_t<R, J, J> : std::integral_constant<size_t, 0> {};
+
+template<typename R, size_t I, size_t J>
+constexpr size_t run_size() { return run_size_t<R, I, J>{}; }
+
+//-----------------------------------------------------------------------------
+// fields I + K... of R: copy from/to bytes at `p`, packed without padding;
+// true if already adjacent in memory, starting at `p`
+
+template<size_t I, typename R, size_t... K>
+void run_get(const R& t, char* p, seq<K...>)
+{
+	using e = int[];
+	(void)e{0, (std::memcpy(p + run_size<R, I, I + K>(), &std::get<I + K>(t),
+		sizeof(field<I + K, R>)), 0)...};
+}
+
+template<size_t I, typename R, size_t... K>
+void run_set(const R& t, const char* p, seq<K...>)
+{
+	using e = int[];
+	(void)e{0, (std::memcpy(&std::get<I + K>(t), p + run_size<R, I, I + K>(),
+		sizeof(field<I + K, R>)), 0)...};
+}
+
+template<size_t I, typename R, size_t... K>
+bool adjacent(const R& t, const char* p, seq<K...>)
+{
+	bool a = true;
+	using e = int[];
+	(void)e{0, (a = a && reinterpret_cast<const char*>(&std::get<I + K>(t)) ==
+		p + run_size<R, I, I + K>(), 0)...};
+	return a;
+}
+
+//-----------------------------------------------------------------------------
+// serialization of run [I, J) of trivial fields of R by a single memory copy,
+// directly if adjacent in memory, otherwise staged through a buffer on the
+// stack; field by field when converting byte order
+
+template<size_t I, size_t J, typename S, typename R>
+void r_run(S& s, const R& t)
+{
+	using K = make_seq<J - I>;
+	constexpr size_t n = run_size<R, I, J>();
+	char* p = reinterpret_cast<char*>(&std::get<I>(t));
+	if(adjacent<I>(t, p, K())) return r_mem(s, p, n);
+	char b[n];
+	r_mem(s, b, n); run_set<I>(t, b, K());
+}
+
+template<size_t I, size_t J, typename S, typename R>
+void w_run(S& s, const R& t)
+{
+	using K = make_seq<J - I>;
+	constexpr size_t n = run_size<R, I, J>();
+	const char* p = reinterpret_cast<const char*>(&std::get<I>(t));
+	if(adjacent<I>(t, p, K())) return w_mem(s, p, n);
+	char b[n];
+	run_get<I>(t, b, K()); w_mem(s, b, n);
+}
+
+template<size_t I, typename S, typename R, size_t... K>
+void r_each(S& s, const R& t, seq<K...>)
+{
+	using e = int[];
+	(void)e{0, (r_mem(s, &std::get<I + K>(t)), 0)...};
+}
+
+template<size_t I, typename S, typename R, size_t... K>
+void w_each(S& s, const R& t, seq<K...>)
+{
+	using e = int[];
+	(void)e{0, (w_mem(s, &std::get<I + K>(t)), 0)...};
+}
+
+template<size_t I, size_t J, typename S, typename R>
+void r_run(swap_istream<S>& s, const R& t) { r_each<I>(s, t, make_seq<J - I>()); }
+
+template<size_t I, size_t J, typename S, typename R>
+void w_run(swap_ostream<S>& s, const R& t) { w_each<I>(s, t, make_seq<J - I>()); }
+
+//-----------------------------------------------------------------------------
+// serialization of fields I, ... of R: either a run of trivial fields, or
+// a non-trivial field as any object, then the remaining fields; position
+// I is given as a tag, so that all overloads are found by argument-dependent
+// lookup
+
+template<size_t I>
+struct field_at {};
+
+template<size_t I, typename X, typename S, typename R,
+	only_if<I == field_count<R>{}> = 0>
+void r_fields(field_at<I>, X, S&, const R&) {}
+
+template<size_t I, typename X, typename S, typename R,
+	only_if<I == field_count<R>{}> = 0>
+void w_fields(field_at<I>, X, S&, const R&) {}
+
+template<size_t I, typename X, typename S, typename R,
+	only_if<(I < field_count<R>{}) && (I < run_end<R, I>{})> = 0>
+void r_fields(field_at<I>, X x, S& s, const R& t)
+{
+	constexpr size_t J = run_end<R, I>::value;
+	r_run<I, J>(s, t); r_fields(field_at<J>(), x, s, t);
+}
+
+template<size_t I, typename X, typename S, typename R,
+	only_if<(I < field_count<R>{}) && (I < run_end<R, I>{})> = 0>
+void w_fields(field_at<I>, X x, S& s, const R& t)
+{
+	constexpr size_t J = run_end<R, I>::value;
+	w_run<I, J>(s, t); w_fields(field_at<J>(), x, s, t);
+}
+
+template<size_t I, typename X, typename S, typename R,
+	only_if<(I < field_count<R>{}) && I == run_end<R, I>{}> = 0>
+void r_fields(field_at<I>, X x, S& s, const R& t)
+{
+	r_main(x, s, std::get<I>(t)); r_fields(field_at<I + 1>(), x, s, t);
+}
+
+template<size_t I, typename X, typename S, typename R,
+	only_if<(I < field_count<R>{}) && I == run_end<R, I>{}> = 0>
+void w_fields(field_at<I>, X x, S& s, const R& t)
+{
+	w_main(x, s, std::get<I>(t)); w_fields(field_at<I + 1>(), x, s, t);
+}
+
+//-----------------------------------------------------------------------------
+// record serialization: fields in order without padding, where runs of
+// consecutive trivial fields are copied at once
+
+template<typename X, typename S, typename A>
+void r_record(X x, S& s, A& a)
+{
+	XIO_STATS_PATH(record);
+	r_fields(field_at<0>(), x, s, fields_of(a));
+}
+
+template<typename X, typename S, typename A>
+void w_record(X x, S& s, const A& a)
+{
+	XIO_STATS_PATH(record);
+	w_fields(field_at<0>(), x, s, fields_of(a));
+}
+
+//-----------------------------------------------------------------------------
+// copy flat record or trivial object `a` from/to bytes at `p`, in the same
+// layout as serialized; return end of bytes
+
+template<typename A, only_if<is_triv<A>{}> = 0>
+const char* get_flat(const char* p, A& a) { std::memcpy(&a, p, sizeof(A)); return p + sizeof(A); }
+
+template<typename A, only_if<is_triv<A>{}> = 0>
+char* put_flat(char* p, const A& a) { std::memcpy(p, &a, sizeof(A)); return p + sizeof(A); }
+
+template<typename R, size_t... I>
+const char* get_fields(const char* p, const R& t, seq<I...>);
+
+template<typename R, size_t... I>
+char* put_fields(char* p, const R& t, seq<I...>);
+
+template<typename A, only_if<!is_triv<A>{}> = 0>
+const char* get_flat(const char* p, A& a)
+{
+	return get_fields(p, fields_of(a), make_seq<field_count<fields<A>>{}>());
+}
+
+template<typename A, only_if<!is_triv<A>{}> = 0>
+char* put_flat(char* p, const A& a)
+{
+	return put_fields(p, fields_of(a), make_seq<field_count<fields<const A>>{}>());
+}
+
+template<typename R, size_t... I>
+const char* get_fields(const char* p, const R& t, seq<I...>)
+{
+	using e = int[];
+	(void)e{0, (p = get_flat(p, std::get<I>(t)), 0)...};
+	return p;
+}
+
+template<typename R, size_t... I>
+char* put_fields(char* p, const R& t, seq<I...>)
+{
+	using e = int[];
+	(void)e{0, (p = put_flat(p, std::get<I>(t)), 0)...};
+	return p;
+}
+
+//-----------------------------------------------------------------------------
+// serialization of range of flat records, packed in chunks through a buffer
+// of bounded size and copied at once per chunk, followed by insertion on
+// reading; element by element when converting byte order
+
+template<typename S, typename A>
+void r_flat(S& s, A& a, size_t n)
+{
+	XIO_STATS_PATH(record);
+	using T = elem<A>;
+	constexpr size_t w = flat_size<T>();
+	size_t m = std::min(n, std::max(stage_size() / w, size_t(1)));
+	raw_vector<char> b(m * w);
+	std::unique_ptr<T[]> v(new T[m]);
+	for(size_t k; n; n -= k)
+	{
+		k = std::min(n, m);
+		r_mem(s, b.data(), k * w);
+		const char* p = b.data();
+		for(size_t j = 0; j < k; ++j) p = get_flat(p, v[j]);
+		insert(a, std::make_move_iterator(v.get()), std::make_move_iterator(v.get() + k));
+	}
+}
+
+template<typename S, typename A>
+void w_flat(S& s, const A& a)
+{
+	XIO_STATS_PATH(record);
+	using T = elem<A>;
+	constexpr size_t w = flat_size<T>();
+	size_t m = std::min(size(a), std::max(stage_size() / w, size_t(1)));
+	raw_vector<char> b(m * w);
+	for(auto i = std::begin(a), e = std::end(a); i != e;)
+	{
+		char* p = b.data();
+		for(size_t k = 0; i != e && k < m; ++i, ++k) p = put_flat(p, *i);
+		w_mem(s, b.data(), p - b.data());
+	}
+}
+
+template<typename S, typename A>
+void r_flat(swap_istream<S>& s, A& a, size_t n)
+{
+	using T = elem<A>;
+	insert(a, begin<T>(s, n), end<T>(s));
+}
+
+template<typename S, typename A>
+void w_flat(swap_ostream<S>& s, const A& a)
+{
+	std::copy(std::begin(a), std::end(a), begin<elem<A>>(s));
+}
+
+//-----------------------------------------------------------------------------
+
+}  // namespace xio_details
+
+//-----------------------------------------------------------------------------
+
+}  // namespace xio
+
+//-----------------------------------------------------------------------------
+
+#endif // XIO_RECORD
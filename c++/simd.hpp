@@ -0,0 +1,49 @@
+#ifndef XIO_SIMD
+#define XIO_SIMD
+
+//-----------------------------------------------------------------------------
+// vectorized kernels are compiled for x86 with gcc/clang and selected at run
+// time according to processor support; scalar versions are used otherwise
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define XIO_X86
+#include <immintrin.h>
+#define XIO_TARGET(t) __attribute__((target(t)))
+#endif
+
+//-----------------------------------------------------------------------------
+
+namespace xio {
+
+//-----------------------------------------------------------------------------
+
+namespace xio_details {
+
+//-----------------------------------------------------------------------------
+// processor support of instruction set extensions
+
+#ifdef XIO_X86
+
+inline bool has_ssse3() { static const bool b = __builtin_cpu_supports("ssse3"); return b; }
+inline bool has_sse42() { static const bool b = __builtin_cpu_supports("sse4.2"); return b; }
+inline bool has_avx2()  { static const bool b = __builtin_cpu_supports("avx2"); return b; }
+
+#else
+
+inline bool has_ssse3() { return false; }
+inline bool has_sse42() { return false; }
+inline bool has_avx2()  { return false; }
+
+#endif
+
+//-----------------------------------------------------------------------------
+
+}  // namespace xio_details
+
+//-----------------------------------------------------------------------------
+
+}  // namespace xio
+
+//-----------------------------------------------------------------------------
+
+#endif // XIO_SIMD
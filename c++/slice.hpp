@@ -0,0 +1,180 @@
+#include <algorithm>
+
+#ifndef XIO_SLICE
+#define XIO_SLICE
+
+//-----------------------------------------------------------------------------
+
+namespace xio {
+
+//-----------------------------------------------------------------------------
+
+namespace xio_details {
+
+//-----------------------------------------------------------------------------
+// dimensions as a vector of sizes and back, for arbitrary dimension types:
+// a scalar for one-dimensional ranges, or a range otherwise
+
+template<typename D, only_if<is_range<D>{}> = 0>
+std::vector<size_t> dim_vec(const D& d)
+{
+	return std::vector<size_t>(std::begin(d), std::end(d));
+}
+
+template<typename D, only_if<!is_range<D>{}> = 0>
+std::vector<size_t> dim_vec(const D& d) { return std::vector<size_t>(1, d); }
+
+template<typename D, only_if<is_range<D>{}> = 0>
+void dim_set(D& d, const std::vector<size_t>& v)
+{
+	std::copy(v.begin(), v.end(), std::begin(d));
+}
+
+template<typename D, only_if<!is_range<D>{}> = 0>
+void dim_set(D& d, const std::vector<size_t>& v) { d = v[0]; }
+
+//-----------------------------------------------------------------------------
+// read hyperslab of stored array with dimensions `d`, starting at `start`
+// with extent `count` in each dimension, where missing entries stand for
+// the entire dimension; elements are stored with the first dimension
+// varying fastest, so the largest possible contiguous runs are read between
+// seeks. The stream is left at the end of the stored array.
+
+template<typename S, typename A, typename D>
+void r_box(S& s, A& a, D& d, std::vector<size_t> start, std::vector<size_t> count)
+{
+	using T = elem<A>;
+	std::vector<size_t> n = dim_vec(d);
+	size_t k = n.size();
+
+	start.resize(k, 0);
+	count.resize(k, size_t(-1));
+	for(size_t i = 0; i < k; ++i)
+	{
+		start[i] = std::min(start[i], n[i]);
+		count[i] = std::min(count[i], n[i] - start[i]);
+	}
+	dim_set(d, count);
+	resize(a, total(count));
+
+	std::vector<size_t> stride(k + 1, 1);
+	for(size_t i = 0; i < k; ++i) stride[i + 1] = stride[i] * n[i];
+	auto p = s.tellg();
+
+	if(size(a))
+	{
+		// dimensions [0, r) are merged into runs of `run` elements
+		size_t m = 0;
+		while(m < k && count[m] == n[m]) m++;
+		size_t r = m < k ? m + 1 : k;
+		size_t run = m < k ? stride[m] * count[m] : stride[k];
+
+		T* out = base(a);
+		std::vector<size_t> i(start);
+		for(bool more = true; more; out += run)
+		{
+			size_t o = 0, j = r;
+			for(size_t l = 0; l < k; ++l) o += i[l] * stride[l];
+			s.seekg(p + std::streamoff(o * sizeof(T)));
+			r_mem(s, out, run);
+
+			for(; j < k && ++i[j] == start[j] + count[j]; ++j) i[j] = start[j];
+			more = j < k;
+		}
+	}
+
+	s.seekg(p + std::streamoff(stride[k] * sizeof(T)));
+}
+
+//-----------------------------------------------------------------------------
+// read hyperslab or range of slices in last dimension (e.g. columns of a
+// two-dimensional array) into contiguous range of trivial elements, after
+// reading stored dimensions; dims(a) are set to those actually read
+
+template<typename S, typename A>
+void xread_slab(S& s, A& a,
+	const std::vector<size_t>& start, const std::vector<size_t>& count)
+{
+	static_assert(is_cont_triv<A>() && !is_fixed<A>(),
+		"Partial reading only supported for resizable contiguous ranges of trivial elements.");
+
+	auto&& d = dims(a); xread(s, d);
+	r_box(s, a, d, start, count);
+}
+
+template<typename S, typename A>
+void xread_slice(S& s, A& a, size_t first, size_t count)
+{
+	static_assert(is_cont_triv<A>() && !is_fixed<A>(),
+		"Partial reading only supported for resizable contiguous ranges of trivial elements.");
+
+	auto&& d = dims(a); xread(s, d);
+	std::vector<size_t> n = dim_vec(d), start(n.size());
+	if(n.size()) { start.back() = first; n.back() = count; }
+	r_box(s, a, d, start, n);
+}
+
+//-----------------------------------------------------------------------------
+// file operations, as above; only the blocks of compressed files actually
+// read are decompressed
+
+struct slab_reader
+{
+	template<typename S, typename A>
+	void operator()(S& s, A& a,
+		const std::vector<size_t>& start, const std::vector<size_t>& count)
+		{ xread_slab(s, a, start, count); }
+};
+
+struct slice_reader
+{
+	template<typename S, typename A>
+	void operator()(S& s, A& a, size_t first, size_t count)
+		{ xread_slice(s, a, first, count); }
+};
+
+template<typename F, typename A>
+void xload_slab(const F& f, A& a,
+	const std::vector<size_t>& start, const std::vector<size_t>& count)
+{
+	XIO_STATS_CALL("load");
+	using std::placeholders::_1;
+	std::vector<char> u(buffer_size());
+	std::ifstream s;
+	header h;
+	xopen(s, f, u); r_head(s, h, f); r_head_type<A>(h, f);
+	if(!r_with(s, h, std::bind(slab_reader(), _1, std::ref(a), std::cref(start), std::cref(count))))
+		throw e_read(f);
+}
+
+template<typename F, typename A>
+void xload_slice(const F& f, A& a, size_t first, size_t count)
+{
+	XIO_STATS_CALL("load");
+	using std::placeholders::_1;
+	std::vector<char> u(buffer_size());
+	std::ifstream s;
+	header h;
+	xopen(s, f, u); r_head(s, h, f); r_head_type<A>(h, f);
+	if(!r_with(s, h, std::bind(slice_reader(), _1, std::ref(a), first, count)))
+		throw e_read(f);
+}
+
+//-----------------------------------------------------------------------------
+
+}  // namespace xio_details
+
+//-----------------------------------------------------------------------------
+
+using xio_details::xread_slab;
+using xio_details::xread_slice;
+using xio_details::xload_slab;
+using xio_details::xload_slice;
+
+//-----------------------------------------------------------------------------
+
+}  // namespace xio
+
+//-----------------------------------------------------------------------------
+
+#endif // XIO_SLICE
@@ -0,0 +1,341 @@
+#include <cstdint>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <ostream>
+
+#ifndef XIO_STATISTICS
+#define XIO_STATISTICS
+
+//-----------------------------------------------------------------------------
+
+namespace xio {
+
+//-----------------------------------------------------------------------------
+// serialization paths, as selected by dispatch on object type: single
+// trivial object, contiguous, segmented or staged range of trivial elements,
+// bits, range of non-trivial elements by iterators, associative range,
+// ragged layout, or record of fields
+
+enum class path { trivial, contiguous, segmented, staged, bits, iterator, map, ragged, record };
+
+constexpr size_t paths = size_t(path::record) + 1;
+
+inline const char* path_name(path p)
+{
+	static const char* n[] = {
+		"trivial", "contiguous", "segmented", "staged", "bits", "iterator", "map", "ragged",
+		"record"
+	};
+	return n[size_t(p)];
+}
+
+//-----------------------------------------------------------------------------
+// counters of a load/save call (total) or a path: number of calls or entries
+// of path, bytes read/written and number of stream calls, allocations
+// reported by stats_alloc(), and wall time in seconds, excluding nested paths
+
+struct counts
+{
+	uint64_t calls = 0, bytes = 0, ios = 0, allocs = 0;
+	double time = 0;
+
+	counts& operator+=(const counts& c)
+	{
+		calls += c.calls; bytes += c.bytes; ios += c.ios; allocs += c.allocs;
+		time += c.time;
+		return *this;
+	}
+};
+
+struct stats
+{
+	counts total;
+	counts by[paths];
+
+	counts& operator[](path p) { return by[size_t(p)]; }
+	const counts& operator[](path p) const { return by[size_t(p)]; }
+
+	stats& operator+=(const stats& s)
+	{
+		total += s.total;
+		for(size_t i = 0; i < paths; ++i) by[i] += s.by[i];
+		return *this;
+	}
+};
+
+// called with operation ("load" or "save") and statistics of each call
+using stats_hook = std::function<void(const char*, const stats&)>;
+
+//-----------------------------------------------------------------------------
+
+namespace xio_details {
+
+//-----------------------------------------------------------------------------
+// global state: summary of all load and save calls, and hook
+
+struct stats_state
+{
+	std::mutex m;
+	stats load, save;
+	stats_hook hook;
+};
+
+inline stats_state& stats_global() { static stats_state s; return s; }
+
+inline void stats_record(const char* op, const stats& s)
+{
+	stats_state& g = stats_global();
+	stats_hook h;
+	{
+		std::lock_guard<std::mutex> l(g.m);
+		(std::strcmp(op, "save") ? g.load : g.save) += s;
+		h = g.hook;
+	}
+	if(h) try { h(op, s); } catch(...) {}
+}
+
+//-----------------------------------------------------------------------------
+// per-thread state: statistics of current call, if any, and innermost path
+
+class stats_scope;
+
+inline stats*& stats_cur() { static thread_local stats* s = nullptr; return s; }
+
+inline stats_scope*& stats_top() { static thread_local stats_scope* p = nullptr; return p; }
+
+using stats_clock = std::chrono::steady_clock;
+
+inline double seconds(stats_clock::duration d) { return std::chrono::duration<double>(d).count(); }
+
+//-----------------------------------------------------------------------------
+// entry of path `p` for the lifetime of this object; time of enclosing path
+// is paused meanwhile
+
+class stats_scope
+{
+	stats* s;
+	stats_scope* up;
+	path p;
+	stats_clock::time_point t;
+
+public:
+	stats_scope(path p) : s(stats_cur()), up(stats_top()), p(p)
+	{
+		if(!s) return;
+		t = stats_clock::now();
+		if(up) up->pause(t);
+		++(*s)[p].calls;
+		stats_top() = this;
+	}
+
+	~stats_scope()
+	{
+		if(!s) return;
+		auto n = stats_clock::now();
+		pause(n);
+		stats_top() = up;
+		if(up) up->t = n;
+	}
+
+	void pause(stats_clock::time_point n) { (*s)[p].time += seconds(n - t); }
+
+	counts& get() { return (*s)[p]; }
+};
+
+//-----------------------------------------------------------------------------
+// load/save call for the lifetime of this object, recorded on destruction;
+// calls nested in another on the same thread are part of the outer one
+
+class stats_call
+{
+	const char* op;
+	stats s;
+	bool root;
+	stats_clock::time_point t;
+
+public:
+	stats_call(const char* op) : op(op), root(!stats_cur())
+	{
+		if(!root) return;
+		stats_cur() = &s;
+		s.total.calls = 1;
+		t = stats_clock::now();
+	}
+
+	~stats_call()
+	{
+		if(!root) return;
+		s.total.time = seconds(stats_clock::now() - t);
+		stats_cur() = nullptr;
+		stats_record(op, s);
+	}
+};
+
+//-----------------------------------------------------------------------------
+// work of the current call, if any, done by other threads: a fork is made on
+// the calling thread and joined by each worker for the lifetime of a join
+// object, collecting into its own statistics, where nested calls are part
+// of the forking one. These are merged into the call when the fork is
+// destroyed, after all workers are done; work outside any path of a worker
+// is attributed to the path of the fork. Path times add up over threads.
+
+class stats_fork
+{
+	friend class stats_join;
+
+	stats* s;
+	stats_scope* p;
+	std::mutex m;
+	stats sum;
+
+public:
+	stats_fork() : s(stats_cur()), p(stats_top()) {}
+
+	stats_fork(const stats_fork&) = delete;
+
+	~stats_fork()
+	{
+		if(!s) return;
+		counts c = sum.total;
+		for(size_t i = 0; i < paths; ++i)
+		{
+			s->by[i] += sum.by[i];
+			c.bytes -= sum.by[i].bytes; c.ios -= sum.by[i].ios; c.allocs -= sum.by[i].allocs;
+		}
+		s->total.bytes += sum.total.bytes; s->total.ios += sum.total.ios;
+		s->total.allocs += sum.total.allocs;
+		if(p) { p->get().bytes += c.bytes; p->get().ios += c.ios; p->get().allocs += c.allocs; }
+	}
+};
+
+class stats_join
+{
+	stats_fork& f;
+	stats s;
+	stats* cur;
+	stats_scope* top;
+
+public:
+	stats_join(stats_fork& f) : f(f), cur(stats_cur()), top(stats_top())
+	{
+		if(!f.s) return;
+		stats_cur() = &s; stats_top() = nullptr;
+	}
+
+	stats_join(const stats_join&) = delete;
+
+	~stats_join()
+	{
+		if(!f.s) return;
+		stats_cur() = cur; stats_top() = top;
+		std::lock_guard<std::mutex> l(f.m);
+		f.sum += s;
+	}
+};
+
+//-----------------------------------------------------------------------------
+// count `n` bytes read or written by one stream call, or one allocation,
+// in current call and path
+
+inline void stats_io(size_t n)
+{
+	if(stats* s = stats_cur())
+	{
+		s->total.bytes += n; ++s->total.ios;
+		if(stats_scope* p = stats_top()) { p->get().bytes += n; ++p->get().ios; }
+	}
+}
+
+inline void stats_alloc()
+{
+	if(stats* s = stats_cur())
+	{
+		++s->total.allocs;
+		if(stats_scope* p = stats_top()) ++p->get().allocs;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// summary of all calls so far of operation `op` ("load" or "save")
+
+inline stats stats_summary(const char* op)
+{
+	stats_state& g = stats_global();
+	std::lock_guard<std::mutex> l(g.m);
+	return std::strcmp(op, "save") ? g.load : g.save;
+}
+
+inline void stats_reset()
+{
+	stats_state& g = stats_global();
+	std::lock_guard<std::mutex> l(g.m);
+	g.load = g.save = stats();
+}
+
+inline void set_stats_hook(stats_hook h)
+{
+	stats_state& g = stats_global();
+	std::lock_guard<std::mutex> l(g.m);
+	g.hook = h;
+}
+
+//-----------------------------------------------------------------------------
+// print summary as a table, one line per operation and path taken
+
+inline void stats_line(std::ostream& o, const char* op, const char* p, const counts& c)
+{
+	o << op << '\t' << p << '\t' << c.calls << '\t' << c.bytes << '\t' << c.ios
+		<< '\t' << c.allocs << '\t' << c.time << '\n';
+}
+
+inline void stats_dump(std::ostream& o)
+{
+	o << "op\tpath\tcalls\tbytes\tios\tallocs\tseconds\n";
+	for(const char* op : {"load", "save"})
+	{
+		stats s = stats_summary(op);
+		stats_line(o, op, "total", s.total);
+		for(size_t i = 0; i < paths; ++i)
+			if(s.by[i].calls) stats_line(o, op, path_name(path(i)), s.by[i]);
+	}
+}
+
+//-----------------------------------------------------------------------------
+
+}  // namespace xio_details
+
+//-----------------------------------------------------------------------------
+
+using xio_details::stats_alloc;
+using xio_details::stats_summary;
+using xio_details::stats_reset;
+using xio_details::set_stats_hook;
+using xio_details::stats_dump;
+
+//-----------------------------------------------------------------------------
+
+}  // namespace xio
+
+//-----------------------------------------------------------------------------
+// instrumentation of load/save calls, paths, stream calls and worker
+// threads, only if XIO_STATS is defined; otherwise, these expand to nothing
+
+#ifdef XIO_STATS
+#define XIO_STATS_CALL(op) xio::xio_details::stats_call xio_call_(op)
+#define XIO_STATS_PATH(p)  xio::xio_details::stats_scope xio_path_(xio::path::p)
+#define XIO_STATS_IO(n)    xio::xio_details::stats_io(n)
+#define XIO_STATS_FORK()   xio::xio_details::stats_fork xio_fork_
+#define XIO_STATS_JOIN()   xio::xio_details::stats_join xio_join_(xio_fork_)
+#else
+#define XIO_STATS_CALL(op)
+#define XIO_STATS_PATH(p)
+#define XIO_STATS_IO(n)
+#define XIO_STATS_FORK()
+#define XIO_STATS_JOIN()
+#endif
+
+//-----------------------------------------------------------------------------
+
+#endif // XIO_STATISTICS
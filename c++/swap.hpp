@@ -0,0 +1,261 @@
+#include <array>
+#include <complex>
+
+#ifndef XIO_SWAP
+#define XIO_SWAP
+
+//-----------------------------------------------------------------------------
+
+namespace xio {
+
+//-----------------------------------------------------------------------------
+
+namespace xio_details {
+
+//-----------------------------------------------------------------------------
+// byte order conversion exception
+
+struct e_swap : std::exception
+{
+	const char* what() const noexcept override
+	{
+		return "byte order conversion unsupported for element type\n";
+	}
+};
+
+//-----------------------------------------------------------------------------
+// width in bytes of scalars whose byte order is reversed in trivial type T:
+// T itself if arithmetic or enum, or its elements if an array or complex;
+// zero if unsupported
+
+template<typename T, typename = void>
+struct swap_width_t : std::integral_constant<size_t, 0> {};
+
+template<typename T>
+struct swap_width_t<T, only_if<std::is_arithmetic<T>{} || std::is_enum<T>{}, void>> :
+	std::integral_constant<size_t, sizeof(T)> {};
+
+template<typename T, size_t N>
+struct swap_width_t<T[N]> : swap_width_t<T> {};
+
+template<typename T, size_t N>
+struct swap_width_t<std::array<T, N>> : swap_width_t<T> {};
+
+template<typename T>
+struct swap_width_t<std::complex<T>> : swap_width_t<T> {};
+
+template<typename T>
+using swap_width = swap_width_t<typename std::remove_cv<T>::type>;
+
+//-----------------------------------------------------------------------------
+// copy `n` bytes from `s` to `d`, reversing byte order of each group of W
+// bytes; scalar version
+
+template<size_t W>
+void swap_copy_sc(char* d, const char* s, size_t n)
+{
+	for(size_t i = 0; i < n; i += W)
+		for(size_t j = 0; j < W; ++j) d[i + j] = s[i + W - 1 - j];
+}
+
+template<>
+inline void swap_copy_sc<2>(char* d, const char* s, size_t n)
+{
+	for(uint16_t x; n; n -= 2, s += 2, d += 2)
+	{
+		std::memcpy(&x, s, 2); x = uint16_t(x << 8 | x >> 8); std::memcpy(d, &x, 2);
+	}
+}
+
+template<>
+inline void swap_copy_sc<4>(char* d, const char* s, size_t n)
+{
+	for(uint32_t x; n; n -= 4, s += 4, d += 4)
+	{
+		std::memcpy(&x, s, 4); x = uint32_t(bswap(x) >> 32); std::memcpy(d, &x, 4);
+	}
+}
+
+template<>
+inline void swap_copy_sc<8>(char* d, const char* s, size_t n)
+{
+	for(uint64_t x; n; n -= 8, s += 8, d += 8)
+	{
+		std::memcpy(&x, s, 8); x = bswap(x); std::memcpy(d, &x, 8);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// vectorized versions by byte shuffling, for W dividing 16; the scalar
+// version processes the remaining bytes
+
+#ifdef XIO_X86
+
+template<size_t W>
+XIO_TARGET("ssse3")
+__m128i swap_mask()
+{
+	alignas(16) char m[16];
+	for(size_t i = 0; i < 16; ++i) m[i] = char(i / W * W + W - 1 - i % W);
+	return _mm_load_si128(reinterpret_cast<const __m128i*>(m));
+}
+
+template<size_t W>
+XIO_TARGET("ssse3")
+void swap_copy_ssse3(char* d, const char* s, size_t n)
+{
+	const __m128i m = swap_mask<W>();
+	size_t i = 0;
+	for(; i + 16 <= n; i += 16)
+	{
+		__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(d + i), _mm_shuffle_epi8(x, m));
+	}
+	swap_copy_sc<W>(d + i, s + i, n - i);
+}
+
+template<size_t W>
+XIO_TARGET("avx2")
+void swap_copy_avx2(char* d, const char* s, size_t n)
+{
+	const __m256i m = _mm256_broadcastsi128_si256(swap_mask<W>());
+	size_t i = 0;
+	for(; i + 32 <= n; i += 32)
+	{
+		__m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(d + i), _mm256_shuffle_epi8(x, m));
+	}
+	swap_copy_sc<W>(d + i, s + i, n - i);
+}
+
+#endif
+
+//-----------------------------------------------------------------------------
+// copy `n` bytes from `s` to `d`, reversing byte order of each group of `w`
+// bytes, using the fastest version available
+
+template<size_t W>
+void swap_copy(char* d, const char* s, size_t n)
+{
+#ifdef XIO_X86
+	if(16 % W == 0 && has_avx2()) return swap_copy_avx2<W>(d, s, n);
+	if(16 % W == 0 && has_ssse3()) return swap_copy_ssse3<W>(d, s, n);
+#endif
+	swap_copy_sc<W>(d, s, n);
+}
+
+inline void swap_copy(char* d, const char* s, size_t n, size_t w)
+{
+	switch(w)
+	{
+		case 2:  return swap_copy<2>(d, s, n);
+		case 4:  return swap_copy<4>(d, s, n);
+		case 8:  return swap_copy<8>(d, s, n);
+		case 16: return swap_copy<16>(d, s, n);
+		default:
+			for(size_t i = 0; i < n; i += w) std::reverse_copy(s + i, s + i + w, d + i);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// stream adaptors converting byte order of scalars during memory copy
+// through a staging buffer, otherwise forwarding to underlying stream `s`
+
+template<typename S>
+class swap_stream
+{
+protected:
+	S& s;
+	raw_vector<char> buf;
+
+public:
+	using char_type = chr<S>;
+
+	swap_stream(S& s) : s(s), buf(stage_size() / 16 * 16 + 16) {}
+
+	S& stream() { return s; }
+	char* data() { return buf.data(); }
+	size_t cap() const { return buf.size(); }
+
+	explicit operator bool() const { return bool(s); }
+	bool operator!() const { return !s; }
+	void clear() { s.clear(); }
+};
+
+template<typename S>
+class swap_istream : public swap_stream<S>
+{
+	using swap_stream<S>::s;
+
+public:
+	using swap_stream<S>::swap_stream;
+
+	swap_istream& read(chr<S>* p, std::streamsize n) { s.read(p, n); return *this; }
+
+	std::streamoff tellg() { return s.tellg(); }
+	swap_istream& seekg(std::streamoff o) { s.seekg(o); return *this; }
+	swap_istream& seekg(std::streamoff o, std::ios_base::seekdir d)
+		{ s.seekg(o, d); return *this; }
+};
+
+template<typename S>
+class swap_ostream : public swap_stream<S>
+{
+	using swap_stream<S>::s;
+
+public:
+	using swap_stream<S>::swap_stream;
+
+	swap_ostream& write(const chr<S>* p, std::streamsize n) { s.write(p, n); return *this; }
+
+	std::streamoff tellp() { return s.tellp(); }
+};
+
+//-----------------------------------------------------------------------------
+// low-level serialization as memory copy with byte order conversion,
+// overriding r_mem()/w_mem() of io.hpp on the adaptors above
+
+template<typename S, typename T>
+void r_mem(swap_istream<S>& s, T* base, size_t size = 1)
+{
+	constexpr size_t w = swap_width<T>();
+	if(w == 0) throw e_swap();
+	if(w == 1) return r_mem(s.stream(), base, size);
+
+	char* d = reinterpret_cast<char*>(base);
+	for(size_t n = size * sizeof(T), k; n; n -= k, d += k)
+	{
+		k = std::min(n, s.cap());
+		r_mem(s.stream(), s.data(), k);
+		swap_copy(d, s.data(), k, w);
+	}
+}
+
+template<typename S, typename T>
+void w_mem(swap_ostream<S>& s, const T* base, size_t size = 1)
+{
+	constexpr size_t w = swap_width<T>();
+	if(w == 0) throw e_swap();
+	if(w == 1) return w_mem(s.stream(), base, size);
+
+	// converted data are passed on as type T, e.g. for compression
+	const char* d = reinterpret_cast<const char*>(base);
+	for(size_t n = size * sizeof(T), k; n; n -= k, d += k)
+	{
+		k = std::min(n, s.cap() / sizeof(T) * sizeof(T));
+		swap_copy(s.data(), d, k, w);
+		w_mem(s.stream(), reinterpret_cast<const T*>(s.data()), k / sizeof(T));
+	}
+}
+
+//-----------------------------------------------------------------------------
+
+}  // namespace xio_details
+
+//-----------------------------------------------------------------------------
+
+}  // namespace xio
+
+//-----------------------------------------------------------------------------
+
+#endif // XIO_SWAP
@@ -1,4 +1,5 @@
 #include <type_traits>
+#include <utility>
 
 #ifndef XIO_TRAITS
 #define XIO_TRAITS
@@ -62,10 +63,13 @@ template<typename A> using has_end = sfinae<_end, A>;
 template<typename A> using _size = decltype(gen<A>().size());
 template<typename A> using has_size = sfinae<_size, A>;
 
-template<typename A> void _ins_rng(A& a) { a.insert(a.begin(), a.end()); }
-template<typename A> using _insert_rng = decltype(_ins_rng(gen<A>()));
+template<typename A> using _insert_rng =
+	decltype(gen<A&>().insert(gen<A&>().begin(), gen<A&>().end()));
 template<typename A> using has_insert_rng = sfinae<_insert_rng, A>;
 
+template<typename A> using _reserve = decltype(gen<A&>().reserve(0));
+template<typename A> using has_reserve = sfinae<_reserve, A>;
+
 //-----------------------------------------------------------------------------
 // container classification
 // is_fixed is defined in fun.hpp
@@ -76,9 +80,18 @@ using is_range = expr<has_begin<A>{} && has_end<A>{}>;
 template<typename A>
 using is_contig = decltype(is_contiguous(gen<A>()));
 
+template<typename A>
+using is_segm = decltype(is_segmented(gen<A>()));
+
 template<typename A>
 using is_seq = expr<!has_insert_rng<A>{}>;
 
+template<typename A>
+using is_bits = decltype(is_bitwise(gen<A>()));
+
+template<typename A>
+using is_bitset = expr<is_bits<A>{} && !is_range<A>{}>;
+
 //-----------------------------------------------------------------------------
 // element (value) type without members, only via begin()
 
@@ -89,11 +102,57 @@ using elem = typename std::decay<decltype(*std::begin(gen<A>()))>::type;
 // element classification
 
 template<typename A>
-using is_triv = std::is_trivially_copyable<A>;
+using is_triv = expr<std::is_trivially_copyable<A>{} && !is_bits<A>{}>;
 
 template<typename A>
 using is_cont_triv = expr<is_contig<A>{} && is_triv<elem<A>>{}>;
 
+//-----------------------------------------------------------------------------
+// associative range of (key, value) pairs, e.g. std::map or std::unordered_map;
+// false for any other type, including non-ranges
+
+template<typename T>
+struct is_entry : _false {};
+
+template<typename K, typename V>
+struct is_entry<std::pair<const K, V>> : _true {};
+
+template<typename A, bool = is_range<A>{}>
+struct is_map_t : expr<!is_seq<A>{} && is_entry<elem<A>>{}> {};
+
+template<typename A>
+struct is_map_t<A, false> : _false {};
+
+template<typename A>
+using is_map = is_map_t<typename std::decay<A>::type>;
+
+//-----------------------------------------------------------------------------
+// contiguous range of trivial elements, serialized by a single memory copy;
+// false for any other type, including non-ranges
+
+template<typename A, bool = is_range<A>{}>
+struct is_bulk_t : is_cont_triv<A> {};
+
+template<typename A>
+struct is_bulk_t<A, false> : _false {};
+
+template<typename A>
+using is_bulk = expr<is_bulk_t<A>{}>;
+
+//-----------------------------------------------------------------------------
+// contiguous range of non-trivial elements, e.g. nested containers, whose
+// elements are serialized independently; false for any other type,
+// including non-ranges
+
+template<typename A, bool = is_range<A>{}>
+struct is_nested_t : expr<is_contig<A>{} && !is_triv<elem<A>>{}> {};
+
+template<typename A>
+struct is_nested_t<A, false> : _false {};
+
+template<typename A>
+using is_nested = expr<is_nested_t<A>{}>;
+
 //-----------------------------------------------------------------------------
 
 template<typename S>